@@ -115,7 +115,7 @@ namespace Carbide {
 
     // Enable an handler to be called by interrupt when the button the button is
     // either pressed or realeased
-    void onButtonPressed(void (*handler)(), bool released) {
+    void onButtonPressed(Callback<> handler, bool released) {
         GPIO::enableInterrupt(PIN_BUTTON, handler, (released ? GPIO::Trigger::RISING : GPIO::Trigger::FALLING));
     }
 
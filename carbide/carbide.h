@@ -39,7 +39,7 @@ namespace Carbide {
     inline void initLeds() { initLedR(); initLedG(); initLedB(); }
     inline void initButton() { GPIO::enableInput(PIN_BUTTON, GPIO::Pulling::PULLUP); }
     inline bool isButtonPressed() { return !GPIO::get(PIN_BUTTON); } // Inverted : the pin is LOW when the button is pressed (pullup)
-    void onButtonPressed(void (*handler)(), bool released=false);
+    void onButtonPressed(Callback<> handler, bool released=false);
     inline bool buttonRisingEdge() { return GPIO::fallingEdge(PIN_BUTTON); } // Rising/falling are also inverted for the same reasons
     inline bool buttonFallingEdge() { return GPIO::risingEdge(PIN_BUTTON); }
     inline void waitButtonPressed() { while (!buttonRisingEdge()); }
@@ -1,8 +1,13 @@
 #include "adc.h"
 #include "pm.h"
+#include "dma.h"
+#include "core.h"
 
 namespace ADC {
 
+    // Interrupt priority, defined in interrupt_priorities.cpp
+    extern uint8_t INTERRUPT_PRIORITY;
+
     // Package-dependant, defined in pins_sam4l_XX.cpp
     extern struct GPIO::Pin PINS[];
 
@@ -19,6 +24,51 @@ namespace ADC {
     // For VCC_0625 and VCC_OVER_2, this is simply the Vcc voltage
     int _vref = 0;
 
+    // Effective reference voltage in mV, derived from _vref and the analog reference
+    int _reference = 0;
+
+    // Calibration of each channel
+    struct Calibration {
+        int offset = 0;
+        int32_t gainCorrection = CALIBRATION_UNITY;
+        int32_t multiplier = 0;
+        int32_t multiplierBipolar = 0;
+    };
+    Calibration _calibration[N_CHANNELS];
+    void updateCalibration(Channel channel);
+
+    // Continuous acquisition
+    int _rxDMAChannel = -1;
+    int _txDMAChannel = -1;
+    bool _acquisitionRunning = false;
+    uint16_t* _acquisitionBuffer = nullptr;
+    int _acquisitionHalfSize = 0;
+    int _acquisitionNextHalf = 0;
+    Callback<uint16_t*, int> _acquisitionHandler;
+    void acquisitionReloadHandler();
+
+    // Window monitor
+    Callback<uint16_t> _windowMonitorHandler;
+    bool _windowMonitorOneShot = false;
+    void interruptHandlerWrapper();
+
+    // List of commands sent to the CDMA register in scan mode
+    uint32_t _scanCommands[MAX_SCAN_ENTRIES];
+
+    // Internal function which computes the SEQCFG value to convert the given channel
+    uint32_t seqcfg(Channel channel, Gain gain, Channel relativeTo, uint32_t trigger) {
+        return 0 << SEQCFG_HWLA                                                   // HWLA : Half Word Left Adjust disabled
+            | (relativeTo != 0xFF) << SEQCFG_BIPOLAR                              // BIPOLAR : single-ended or bipolar mode
+            | static_cast<int>(gain) << SEQCFG_GAIN                               // GAIN : user-selected gain
+            | 1 << SEQCFG_GCOMP                                                   // GCOMP : gain error reduction enabled
+            | trigger << SEQCFG_TRGSEL                                            // TRGSEL : trigger source
+            | 0 << SEQCFG_RES                                                     // RES : 12-bit resolution
+            | (relativeTo != 0xFF ? 0b00 : 0b10) << SEQCFG_INTERNAL               // INTERNAL : POS external, NEG internal or external
+            | (channel & 0b1111) << SEQCFG_MUXPOS                                 // MUXPOS : selected channel
+            | (relativeTo != 0xFF ? relativeTo & 0b111 : 0b111) << SEQCFG_MUXNEG  // MUXNEG : pad ground or neg channel
+            | 0b000 << SEQCFG_ZOOMRANGE;                                          // ZOOMRANGE : default
+    }
+
 
     // Initialize the common ressources of the ADC controller
     void init(AnalogReference analogReference, int vref) {
@@ -29,6 +79,17 @@ namespace ADC {
         _analogReference = analogReference;
         _vref = vref;
 
+        // Compute the effective reference and the conversion factors of every channel
+        _reference = vref;
+        if (analogReference == AnalogReference::VCC_0625) {
+            _reference = (vref * 625) / 1000;
+        } else if (analogReference == AnalogReference::VCC_OVER_2) {
+            _reference = vref / 2;
+        }
+        for (int i = 0; i < N_CHANNELS; i++) {
+            updateCalibration(i);
+        }
+
         // Enable the clock
         PM::enablePeripheralClock(PM::CLK_ADC);
 
@@ -99,18 +160,8 @@ namespace ADC {
             enable(relativeTo);
         }
 
-        // SEQCFG (Sequencer Configuration Register) : setup the conversion
-        (*(volatile uint32_t*)(ADC_BASE + OFFSET_SEQCFG))
-            = 0 << SEQCFG_HWLA                                                    // HWLA : Half Word Left Adjust disabled
-            | (relativeTo != 0xFF) << SEQCFG_BIPOLAR                              // BIPOLAR : single-ended or bipolar mode
-            | static_cast<int>(gain) << SEQCFG_GAIN                               // GAIN : user-selected gain
-            | 1 << SEQCFG_GCOMP                                                   // GCOMP : gain error reduction enabled
-            | 0b000 << SEQCFG_TRGSEL                                              // TRGSEL : software trigger
-            | 0 << SEQCFG_RES                                                     // RES : 12-bit resolution
-            | (relativeTo != 0xFF ? 0b00 : 0b10) << SEQCFG_INTERNAL               // INTERNAL : POS external, NEG internal or external
-            | (channel & 0b1111) << SEQCFG_MUXPOS                                 // MUXPOS : selected channel
-            | (relativeTo != 0xFF ? relativeTo & 0b111 : 0b111) << SEQCFG_MUXNEG  // MUXNEG : pad ground or neg channel
-            | 0b000 << SEQCFG_ZOOMRANGE;                                          // ZOOMRANGE : default
+        // SEQCFG (Sequencer Configuration Register) : setup the conversion with a software trigger
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_SEQCFG)) = seqcfg(channel, gain, relativeTo, TRGSEL_SOFTWARE);
 
         // CR (Control Register) : start conversion
         (*(volatile uint32_t*)(ADC_BASE + OFFSET_CR))
@@ -128,43 +179,361 @@ namespace ADC {
 
     // Return the current value on the given channel in mV
     int read(Channel channel, Gain gain, Channel relativeTo) {
-        int value = readRaw(channel, gain, relativeTo);
-
-        // Compute reference
-        int vref = _vref;
-        if (_analogReference == AnalogReference::VCC_0625) {
-            vref = (vref * 625) / 1000;
-        } else if (_analogReference == AnalogReference::VCC_OVER_2) {
-            vref = vref / 2;
-        } else if (_analogReference == AnalogReference::INTERNAL_1V) {
-            vref = 1000;
+        return toMillivolts(readRaw(channel, gain, relativeTo), channel, gain, relativeTo);
+    }
+
+    void setPin(Channel channel, GPIO::Pin pin) {
+        PINS[channel] = pin;
+    }
+
+    // Internal function which precomputes the conversion factors of the given channel. The factors
+    // are the number of mV per count at unity gain in Q16, including the reference voltage and
+    // the gain correction, so that a conversion only requires one multiplication and one shift.
+    // Single-ended : value = gain * voltage / ref * 4095 <=> voltage = value * ref / (gain * 4095)
+    // Differential : value = 2047 + gain * voltage / ref * 2047 <=> voltage = (value - 2047) * ref / (gain * 2047)
+    void updateCalibration(Channel channel) {
+        Calibration& c = _calibration[channel];
+        int64_t k = (int64_t)_reference * c.gainCorrection;
+        c.multiplier = k / 4095;
+        c.multiplierBipolar = k / 2047;
+    }
+
+    // Set the calibration of the given channel : the offset (in counts) is subtracted from each
+    // sample, and the gain correction (in Q16, CALIBRATION_UNITY being 1.0) is applied to the result
+    void setCalibration(Channel channel, int offset, int32_t gainCorrection) {
+        if (channel >= N_CHANNELS) {
+            return;
         }
+        _calibration[channel].offset = offset;
+        _calibration[channel].gainCorrection = gainCorrection;
+        updateCalibration(channel);
+    }
 
-        // Convert the result to mV
-        // Single-ended : value = gain * voltage / ref * 4095 <=> voltage = value * ref / (gain * 4095)
-        // Differential : value = 2047 + gain * voltage / ref * 2047 <=> voltage = (value - 2047) * ref / (gain * 2047)
+    // Convert a raw value measured on the given channel to mV
+    int toMillivolts(uint16_t value, Channel channel, Gain gain, Channel relativeTo) {
+        int result = 0;
+        toMillivolts(&value, &result, 1, channel, gain, relativeTo);
+        return result;
+    }
+
+    // Convert a block of raw values measured on the given channel to mV, for example a buffer
+    // received from startAcquisition(). The gains are powers of two, which are applied with the
+    // same shift as the Q16 multiplier.
+    void toMillivolts(const uint16_t* values, int* results, int n, Channel channel, Gain gain, Channel relativeTo) {
+        if (channel >= N_CHANNELS) {
+            return;
+        }
+        const Calibration& c = _calibration[channel];
+        int32_t offset = c.offset;
+        int32_t multiplier = c.multiplier;
         if (relativeTo != 0xFF) {
-            value -= 2047;
+            offset += 2047;
+            multiplier = c.multiplierBipolar;
         }
-        int gainCoefficients[] = {1, 2, 4, 8, 16, 32, 64};
-        if (gain == Gain::X05) {
-            value *= 2;
+        int shift = gain == Gain::X05 ? 15 : 16 + static_cast<int>(gain);
+        int32_t rounding = 1 << (shift - 1);
+        for (int i = 0; i < n; i++) {
+            results[i] = ((values[i] - offset) * multiplier + rounding) >> shift;
         }
-        value *= vref;
-        if (relativeTo != 0xFF) {
-            value /= 2047;
-        } else {
-            value /= 4095;
+    }
+
+    // Internal function which configures the speed mode and the internal timer for the given sample rate
+    bool setupTimer(unsigned long sampleRate) {
+        if (_acquisitionRunning) {
+            Error::happened(Error::Module::ADC, ERR_ACQUISITION_RUNNING, Error::Severity::CRITICAL);
+            return false;
+        }
+
+        // Compute the internal timer period : the timer is clocked by the ADC clock selected in
+        // CFG.CLKSEL (APB clock) and triggers a conversion every ITMC+1 cycles
+        unsigned long frequency = PM::getModuleClockFrequency(PM::CLK_ADC);
+        if (sampleRate == 0 || sampleRate > 300000 || frequency / sampleRate > 0x10000) {
+            Error::happened(Error::Module::ADC, ERR_INVALID_SAMPLE_RATE, Error::Severity::CRITICAL);
+            return false;
         }
-        if (gain != Gain::X05) {
-            value /= gainCoefficients[static_cast<int>(gain)];
+        uint32_t itmc = frequency / sampleRate - 1;
+
+        // CFG (Configuration Register) : select the lowest-power speed mode which supports this rate
+        uint32_t speed = 0b11; // 75ksps
+        if (sampleRate > 225000) {
+            speed = 0b00; // 300ksps
+        } else if (sampleRate > 150000) {
+            speed = 0b01; // 225ksps
+        } else if (sampleRate > 75000) {
+            speed = 0b10; // 150ksps
         }
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_CFG))
+            = ((*(volatile uint32_t*)(ADC_BASE + OFFSET_CFG)) & ~(uint32_t)(0b11 << CFG_SPEED))
+            | speed << CFG_SPEED;
+
+        // ITIMER (Internal Timer Register) : set the sample period
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_ITIMER))
+            = itmc << ITIMER_ITMC;
 
-        return value;
+        // SCR (Status Clear Register) : clear the flags
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_SCR)) = 1 << SR_SEOC | 1 << SR_LOVR | 1 << SR_WM | 1 << SR_SMTRG | 1 << SR_TTO;
+
+        return true;
     }
 
-    void setPin(Channel channel, GPIO::Pin pin) {
-        PINS[channel] = pin;
+    // Internal function which configures the internal timer and sets up the RX DMA channel to stream
+    // the results into the buffer. The buffer is used as a double buffer : the first half is
+    // transferred first, then the DMA automatically reloads the second half. Each reload triggers
+    // the Reload Empty interrupt.
+    bool setupStream(unsigned long sampleRate, uint16_t* buffer, int size, Callback<uint16_t*, int> handler) {
+        if (size < 2) {
+            Error::happened(Error::Module::ADC, ERR_INVALID_BUFFER_SIZE, Error::Severity::CRITICAL);
+            return false;
+        }
+        if (!setupTimer(sampleRate)) {
+            return false;
+        }
+
+        // Save the acquisition parameters
+        _acquisitionBuffer = buffer;
+        _acquisitionHalfSize = size / 2;
+        _acquisitionNextHalf = 0;
+        _acquisitionHandler = handler;
+
+        // Set up the DMA channel
+        _rxDMAChannel = DMA::setupChannel(_rxDMAChannel, DMA::Device::ADC_RX, DMA::Size::HALFWORD);
+        if (_rxDMAChannel < 0) {
+            return false;
+        }
+        DMA::startChannel(_rxDMAChannel, (uint32_t)_acquisitionBuffer, _acquisitionHalfSize);
+        DMA::reloadChannel(_rxDMAChannel, (uint32_t)(_acquisitionBuffer + _acquisitionHalfSize), _acquisitionHalfSize);
+        DMA::enableInterrupt(_rxDMAChannel, acquisitionReloadHandler, DMA::Interrupt::RELOAD_EMPTY);
+
+        return true;
+    }
+
+    // Internal function which starts the internal timer, after the sequencer has been configured
+    void startStream() {
+        // CR (Control Register) : start the internal timer
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_CR))
+            = 1 << CR_TSTART;   // TSTART : Internal Timer Start
+
+        _acquisitionRunning = true;
+    }
+
+    // Start a continuous acquisition on the given channel, triggered by the ADC internal timer at
+    // the given sample rate (in Hz). The samples are streamed by the DMA into the buffer, which is
+    // used as a double buffer : each time one half is full, the handler is called with this half
+    // while the DMA fills the other one. The handler must therefore process the samples in less
+    // than size/2 sample periods.
+    bool startAcquisition(Channel channel, unsigned long sampleRate, uint16_t* buffer, int size, Callback<uint16_t*, int> handler, Gain gain, Channel relativeTo) {
+        // Enable the channels if they are not already
+        if (!(_enabledChannels & 1 << channel)) {
+            enable(channel);
+        }
+        if (relativeTo != 0xFF && !(_enabledChannels & 1 << relativeTo)) {
+            enable(relativeTo);
+        }
+
+        if (!setupStream(sampleRate, buffer, size, handler)) {
+            return false;
+        }
+
+        // SEQCFG (Sequencer Configuration Register) : setup the conversion with the internal timer as trigger
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_SEQCFG)) = seqcfg(channel, gain, relativeTo, TRGSEL_INTERNAL_TIMER);
+
+        startStream();
+        return true;
+    }
+
+    // Start a continuous scan of a list of channels, each with its own gain and negative input.
+    // The configuration of each conversion is written to the CDMA register by a second DMA channel
+    // which cycles through the list, so the channels are converted back to back at the given
+    // sample rate without any CPU involvement. The results are interleaved in the buffer in the
+    // order of the list, which is used as a double buffer as in startAcquisition() : each half
+    // must contain a whole number of scans, so size must be a multiple of 2 * nEntries.
+    bool startScan(const ScanEntry* list, int nEntries, unsigned long sampleRate, uint16_t* buffer, int size, Callback<uint16_t*, int> handler) {
+        if (nEntries <= 0 || nEntries > MAX_SCAN_ENTRIES || size % (2 * nEntries) != 0) {
+            Error::happened(Error::Module::ADC, ERR_INVALID_SCAN_LIST, Error::Severity::CRITICAL);
+            return false;
+        }
+
+        // Enable the channels and compute the command of each entry
+        for (int i = 0; i < nEntries; i++) {
+            const ScanEntry& entry = list[i];
+            if (!(_enabledChannels & 1 << entry.channel)) {
+                enable(entry.channel);
+            }
+            if (entry.relativeTo != 0xFF && !(_enabledChannels & 1 << entry.relativeTo)) {
+                enable(entry.relativeTo);
+            }
+
+            // CDMA (Configuration Direct Memory Access Register) : first DMA word format
+            _scanCommands[i]
+                = 0 << CDMA_HWLA                                                                  // HWLA : Half Word Left Adjust disabled
+                | (entry.relativeTo != 0xFF) << CDMA_BIPOLAR                                      // BIPOLAR : single-ended or bipolar mode
+                | 0 << CDMA_STRIG                                                                 // STRIG : wait for the internal timer
+                | static_cast<int>(entry.gain) << CDMA_GAIN                                       // GAIN : user-selected gain
+                | 1 << CDMA_GCOMP                                                                 // GCOMP : gain error reduction enabled
+                | 0 << CDMA_RES                                                                   // RES : 12-bit resolution
+                | (entry.relativeTo != 0xFF ? 0b00 : 0b10) << CDMA_INTERNAL                       // INTERNAL : POS external, NEG internal or external
+                | (entry.channel & 0b1111) << CDMA_MUXPOS                                         // MUXPOS : selected channel
+                | (entry.relativeTo != 0xFF ? entry.relativeTo & 0b111 : 0b111) << CDMA_MUXNEG    // MUXNEG : pad ground or neg channel
+                | 0b000 << CDMA_ZOOMRANGE                                                         // ZOOMRANGE : default
+                | 0 << CDMA_DW;                                                                   // DW : single word
+        }
+
+        if (!setupStream(sampleRate, buffer, size, handler)) {
+            return false;
+        }
+
+        // SEQCFG (Sequencer Configuration Register) : only the trigger source is used, the rest of the
+        // configuration will be overwritten by the commands
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_SEQCFG)) = seqcfg(list[0].channel, list[0].gain, list[0].relativeTo, TRGSEL_INTERNAL_TIMER);
+
+        // Set up the TX DMA channel in ring mode to send the list of commands indefinitely
+        _txDMAChannel = DMA::setupChannel(_txDMAChannel, DMA::Device::ADC_TX, DMA::Size::WORD, (uint32_t)_scanCommands, nEntries, true);
+        if (_txDMAChannel < 0) {
+            DMA::freeChannel(_rxDMAChannel);
+            _rxDMAChannel = -1;
+            return false;
+        }
+        DMA::startChannel(_txDMAChannel);
+
+        startStream();
+        return true;
+    }
+
+    // Start free-running conversions on the given channel, triggered by the internal timer at the
+    // given sample rate (in Hz), without transferring the results. This is meant to be used with
+    // the window monitor : the CPU is only woken up when a sample is out of the configured range.
+    bool startMonitor(Channel channel, unsigned long sampleRate, Gain gain, Channel relativeTo) {
+        // Enable the channels if they are not already
+        if (!(_enabledChannels & 1 << channel)) {
+            enable(channel);
+        }
+        if (relativeTo != 0xFF && !(_enabledChannels & 1 << relativeTo)) {
+            enable(relativeTo);
+        }
+
+        if (!setupTimer(sampleRate)) {
+            return false;
+        }
+
+        // SEQCFG (Sequencer Configuration Register) : setup the conversion with the internal timer as trigger
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_SEQCFG)) = seqcfg(channel, gain, relativeTo, TRGSEL_INTERNAL_TIMER);
+
+        startStream();
+        return true;
+    }
+
+    // Enable the window monitor : the handler will be called with the value of every conversion which
+    // matches the given mode relative to the low and high thresholds (in raw counts). The monitor
+    // applies to the conversions of startMonitor(), startAcquisition() and startScan() as well as
+    // to readRaw().
+    // The interrupt is raised for each matching conversion, i.e. up to the sample rate while the
+    // signal stays in the matching range, which can starve lower-priority work at high sample rates.
+    // With oneShot, the interrupt is disabled after the first match, until rearmWindowMonitor().
+    void enableWindowMonitor(WindowMode mode, uint16_t low, uint16_t high, Callback<uint16_t> handler, bool oneShot) {
+        _windowMonitorHandler = handler;
+        _windowMonitorOneShot = oneShot;
+
+        // WTH (Window Monitor Threshold Configuration Register) : set the thresholds
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_WTH))
+            = (low & 0xFFF) << WTH_LOWTHRES     // LOWTHRES : low threshold
+            | (high & 0xFFF) << WTH_HIGHTHRES;  // HIGHTHRES : high threshold
+
+        // WCFG (Window Monitor Configuration Register) : set the mode
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_WCFG))
+            = static_cast<int>(mode) << WCFG_WM;
+
+        // SCR (Status Clear Register) : clear the Window Monitor flag
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_SCR)) = 1 << SR_WM;
+
+        // IER (Interrupt Enable Register) : enable the Window Monitor interrupt
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_IER)) = 1 << SR_WM;
+
+        Core::setInterruptHandler(Core::Interrupt::ADCIFE, interruptHandlerWrapper);
+        Core::enableInterrupt(Core::Interrupt::ADCIFE, INTERRUPT_PRIORITY);
+    }
+
+    // Enable the Window Monitor interrupt again after it has been triggered in one-shot mode
+    void rearmWindowMonitor() {
+        // SCR (Status Clear Register) : clear the Window Monitor flag raised since the last match
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_SCR)) = 1 << SR_WM;
+
+        // IER (Interrupt Enable Register) : enable the Window Monitor interrupt
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_IER)) = 1 << SR_WM;
+    }
+
+    void disableWindowMonitor() {
+        // IDR (Interrupt Disable Register) : disable the Window Monitor interrupt
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_IDR)) = 1 << SR_WM;
+        Core::disableInterrupt(Core::Interrupt::ADCIFE);
+
+        // WCFG (Window Monitor Configuration Register) : turn the monitor off
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_WCFG))
+            = static_cast<int>(WindowMode::DISABLED) << WCFG_WM;
+
+        _windowMonitorHandler = nullptr;
+    }
+
+    void interruptHandlerWrapper() {
+        // LCV (Last Converted Value) : the value which triggered the monitor
+        uint16_t value = (*(volatile uint32_t*)(ADC_BASE + OFFSET_LCV)) & 0xFFFF;
+
+        // SCR (Status Clear Register) : clear the Window Monitor flag
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_SCR)) = 1 << SR_WM;
+
+        // IDR (Interrupt Disable Register) : in one-shot mode, disable the interrupt until rearmWindowMonitor()
+        if (_windowMonitorOneShot) {
+            (*(volatile uint32_t*)(ADC_BASE + OFFSET_IDR)) = 1 << SR_WM;
+        }
+
+        // Call the user handler
+        if (_windowMonitorHandler) {
+            _windowMonitorHandler(value);
+        }
+    }
+
+    // Stop the continuous acquisition, scan or monitor and release the DMA channels
+    void stopAcquisition() {
+        if (!_acquisitionRunning) {
+            return;
+        }
+
+        // CR (Control Register) : stop the internal timer
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_CR))
+            = 1 << CR_TSTOP;    // TSTOP : Internal Timer Stop
+
+        // SEQCFG (Sequencer Configuration Register) : go back to software trigger
+        (*(volatile uint32_t*)(ADC_BASE + OFFSET_SEQCFG)) &= ~(uint32_t)(0b111 << SEQCFG_TRGSEL);
+
+        // Release the DMA channels
+        if (_rxDMAChannel > -1) {
+            DMA::freeChannel(_rxDMAChannel);
+            _rxDMAChannel = -1;
+        }
+        if (_txDMAChannel > -1) {
+            DMA::freeChannel(_txDMAChannel);
+            _txDMAChannel = -1;
+        }
+
+        _acquisitionRunning = false;
+    }
+
+    bool isAcquisitionRunning() {
+        return _acquisitionRunning;
+    }
+
+    void acquisitionReloadHandler() {
+        // The half which was just filled is the one to reload : the DMA is now working
+        // on the other half
+        uint16_t* half = _acquisitionBuffer + _acquisitionNextHalf * _acquisitionHalfSize;
+        _acquisitionNextHalf = !_acquisitionNextHalf;
+
+        // Queue this half again after the current one, which also clears the interrupt
+        DMA::reloadChannel(_rxDMAChannel, (uint32_t)half, _acquisitionHalfSize);
+
+        // Call the user handler
+        if (_acquisitionHandler) {
+            _acquisitionHandler(half, _acquisitionHalfSize);
+        }
     }
 
-}
\ No newline at end of file
+}
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include "gpio.h"
 #include "error.h"
+#include "callback.h"
 
 // Analog to Digital Converter
 // This module is used to measure an analog voltage on a pin
@@ -45,6 +46,10 @@ namespace ADC {
     const uint32_t CFG_CLKSEL = 6;
     const uint32_t CFG_PRESCAL = 8;
     const uint32_t SR_SEOC = 0;
+    const uint32_t SR_LOVR = 1;
+    const uint32_t SR_WM = 2;
+    const uint32_t SR_SMTRG = 3;
+    const uint32_t SR_TTO = 5;
     const uint32_t SR_EN = 24;
     const uint32_t SR_TBUSY = 25;
     const uint32_t SR_SBUSY = 26;
@@ -60,10 +65,32 @@ namespace ADC {
     const uint32_t SEQCFG_MUXPOS = 16;
     const uint32_t SEQCFG_MUXNEG = 20;
     const uint32_t SEQCFG_ZOOMRANGE = 28;
+    const uint32_t ITIMER_ITMC = 0;
+    const uint32_t WCFG_WM = 12;
+    const uint32_t WTH_LOWTHRES = 0;
+    const uint32_t WTH_HIGHTHRES = 16;
+    const uint32_t CDMA_HWLA = 0;
+    const uint32_t CDMA_BIPOLAR = 2;
+    const uint32_t CDMA_STRIG = 3;
+    const uint32_t CDMA_GAIN = 4;
+    const uint32_t CDMA_GCOMP = 7;
+    const uint32_t CDMA_ENSTUP = 8;
+    const uint32_t CDMA_RES = 12;
+    const uint32_t CDMA_TSS = 13;
+    const uint32_t CDMA_INTERNAL = 14;
+    const uint32_t CDMA_MUXPOS = 16;
+    const uint32_t CDMA_MUXNEG = 20;
+    const uint32_t CDMA_ZOOMRANGE = 28;
+    const uint32_t CDMA_DW = 31;
 
 
     using Channel = uint8_t;
 
+    // Sequencer trigger sources
+    const uint32_t TRGSEL_SOFTWARE = 0b000;
+    const uint32_t TRGSEL_INTERNAL_TIMER = 0b001;
+    const uint32_t TRGSEL_CONTINUOUS = 0b011;
+
     enum class AnalogReference {
         INTERNAL_1V = 0b000,
         VCC_0625 = 0b001, // VCC * 0.625
@@ -83,6 +110,33 @@ namespace ADC {
         X05 = 0b111, // divided by 2
     };
 
+    // Window monitor modes, relative to the low (LT) and high (HT) thresholds
+    enum class WindowMode {
+        DISABLED = 0b000,
+        ABOVE_LOW = 0b001,  // value > LT
+        BELOW_HIGH = 0b010, // value < HT
+        INSIDE = 0b011,     // LT < value < HT
+        OUTSIDE = 0b100,    // value < LT or value > HT
+    };
+
+    // Calibration
+    const int N_CHANNELS = 15;
+    const int32_t CALIBRATION_UNITY = 1 << 16; // Gain correction of 1.0 in Q16
+
+    // Scan mode
+    const int MAX_SCAN_ENTRIES = 16;
+    struct ScanEntry {
+        Channel channel;
+        Gain gain;
+        Channel relativeTo;
+    };
+
+    // Error codes
+    const Error::Code ERR_INVALID_SAMPLE_RATE = 0x0001;
+    const Error::Code ERR_ACQUISITION_RUNNING = 0x0002;
+    const Error::Code ERR_INVALID_SCAN_LIST = 0x0003;
+    const Error::Code ERR_INVALID_BUFFER_SIZE = 0x0004;
+
 
     // Module API
     void init(AnalogReference analogReference=AnalogReference::VCC_OVER_2, int vref=3300);
@@ -92,6 +146,23 @@ namespace ADC {
     int read(Channel channel, Gain gain=Gain::X05, Channel relativeTo=0xFF);
     void setPin(Channel channel, GPIO::Pin pin);
 
+    // Calibration and conversion to mV
+    void setCalibration(Channel channel, int offset, int32_t gainCorrection=CALIBRATION_UNITY);
+    int toMillivolts(uint16_t value, Channel channel, Gain gain=Gain::X05, Channel relativeTo=0xFF);
+    void toMillivolts(const uint16_t* values, int* results, int n, Channel channel, Gain gain=Gain::X05, Channel relativeTo=0xFF);
+
+    // Continuous acquisition
+    bool startAcquisition(Channel channel, unsigned long sampleRate, uint16_t* buffer, int size, Callback<uint16_t*, int> handler, Gain gain=Gain::X05, Channel relativeTo=0xFF);
+    bool startScan(const ScanEntry* list, int nEntries, unsigned long sampleRate, uint16_t* buffer, int size, Callback<uint16_t*, int> handler);
+    bool startMonitor(Channel channel, unsigned long sampleRate, Gain gain=Gain::X05, Channel relativeTo=0xFF);
+    void stopAcquisition();
+    bool isAcquisitionRunning();
+
+    // Window monitor
+    void enableWindowMonitor(WindowMode mode, uint16_t low, uint16_t high, Callback<uint16_t> handler, bool oneShot=false);
+    void rearmWindowMonitor();
+    void disableWindowMonitor();
+
 }
 
 
@@ -9,13 +9,17 @@ namespace AST {
     Time _currentTimeHighBytes = 0;
 
     // User handler for the Alarm interrupt
-    void (*_alarmHandler)();
+    Callback<> _alarmHandler;
+
+    // User handler for the Periodic interrupt
+    Callback<> _periodicHandler;
     extern uint8_t INTERRUPT_PRIORITY;
 
 
     // Internal functions
     void overflowHandler();
     void alarmHandlerWrapper();
+    void periodicHandlerWrapper();
     inline void waitWhileBusy() {
         while ((*(volatile uint32_t*)(BASE + OFFSET_SR)) & (1 << SR_BUSY));
     };
@@ -73,7 +77,7 @@ namespace AST {
                 = 1 << CR_EN;
     }
 
-    void enableAlarm(Time time, bool relative, void (*handler)(), bool wake) {
+    void enableAlarm(Time time, bool relative, Callback<> handler, bool wake) {
         // Critical section
         Core::disableInterrupts();
 
@@ -134,6 +138,58 @@ namespace AST {
         (*(volatile uint32_t*)(BASE + OFFSET_IDR)) = 1 << SR_ALARM0;
     }
 
+    // Return the 64-bit value of the counter, in cycles of COUNTER_FREQUENCY. Unlike time(), this
+    // is consistent even if the counter overflows while it is read, or if the overflow interrupt
+    // has not been handled yet (inside a critical section or a higher-priority handler).
+    uint64_t counter() {
+        uint64_t high = 0;
+        uint32_t cv = 0;
+        do {
+            high = _currentTimeHighBytes;
+            cv = *(volatile uint32_t*)(BASE + OFFSET_CV);
+        } while (high != _currentTimeHighBytes);
+
+        // SR (Status Register) : if the overflow is still pending, the value that was read
+        // belongs to the next period
+        if (((*(volatile uint32_t*)(BASE + OFFSET_SR)) & (1 << SR_OVF)) && cv < 0x80000000) {
+            high += (uint64_t)1 << 32;
+        }
+        return high + cv;
+    }
+
+    // Call the handler periodically, every 2^(interval+1) cycles of the 32768Hz clock
+    // (interval=14 gives a period of 1s)
+    void enablePeriodicInterrupt(uint8_t interval, Callback<> handler, bool wake) {
+        _periodicHandler = handler;
+
+        // PIR0 (Periodic Interval Register 0) : select the prescaler bit which triggers the event
+        waitWhileBusy();
+        (*(volatile uint32_t*)(BASE + OFFSET_PIR0)) = (interval & 0x1F) << PIR0_INSEL;
+
+        // SCR (Status Clear Register) : clear the interrupt
+        waitWhileBusy();
+        (*(volatile uint32_t*)(BASE + OFFSET_SCR)) = 1 << SR_PER0;
+
+        // WER (Wake Enable Register) : the register is shared with the other interrupts
+        if (wake) {
+            waitWhileBusy();
+            (*(volatile uint32_t*)(BASE + OFFSET_WER)) |= 1 << SR_PER0;
+        }
+
+        // IER (Interrupt Enable Register) : enable the Periodic interrupt
+        (*(volatile uint32_t*)(BASE + OFFSET_IER)) = 1 << SR_PER0;
+
+        // Set the handler and enable the module interrupt at the Core level
+        Core::setInterruptHandler(Core::Interrupt::AST_PER, periodicHandlerWrapper);
+        Core::enableInterrupt(Core::Interrupt::AST_PER, INTERRUPT_PRIORITY);
+    }
+
+    void disablePeriodicInterrupt() {
+        // IDR (Interrupt Disable Register) : disable the Periodic interrupt
+        (*(volatile uint32_t*)(BASE + OFFSET_IDR)) = 1 << SR_PER0;
+        _periodicHandler = nullptr;
+    }
+
     void overflowHandler() {
         // Increment the high bytes of the 64-bit counter
         _currentTimeHighBytes += (uint64_t)1 << 32;
@@ -145,7 +201,7 @@ namespace AST {
 
     void alarmHandlerWrapper() {
         // Call the user handler if defined
-        if (_alarmHandler != nullptr) {
+        if (_alarmHandler) {
             _alarmHandler();
         }
 
@@ -158,4 +214,15 @@ namespace AST {
         (*(volatile uint32_t*)(BASE + OFFSET_SCR)) = 1 << SR_ALARM0;
     }
 
+    void periodicHandlerWrapper() {
+        // SCR (Status Clear Register) : clear the interrupt
+        waitWhileBusy();
+        (*(volatile uint32_t*)(BASE + OFFSET_SCR)) = 1 << SR_PER0;
+
+        // Call the user handler if defined
+        if (_periodicHandler) {
+            _periodicHandler();
+        }
+    }
+
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define _AST_H_
 
 #include <stdint.h>
+#include "callback.h"
 
 // Asynchronous Timer
 // This module manages the 32-bit asynchronous timer/counter
@@ -45,12 +46,16 @@ namespace AST {
     const uint32_t SR_READY = 25;
     const uint32_t SR_CLKBUSY = 28;
     const uint32_t SR_CLKRDY = 29;
+    const uint32_t PIR0_INSEL = 0;
     const uint32_t CLOCK_CEN = 0;
     const uint32_t CLOCK_CSSEL = 8;
     const uint32_t DTR_EXP = 0;
     const uint32_t DTR_ADD = 5;
     const uint32_t DTR_VALUE = 8;
 
+    // The 32768Hz input clock is prescaled by 2
+    const unsigned long COUNTER_FREQUENCY = 32768 / 2; // Hz
+
     using Time = volatile uint64_t;
     extern Time _currentTimeHighBytes;
 
@@ -58,8 +63,11 @@ namespace AST {
     // Module API
     void init();
     inline volatile Time time() { return ((_currentTimeHighBytes + (*(volatile uint32_t*)(BASE + OFFSET_CV))) * 1000) / (32768/2); };
-    void enableAlarm(Time time, bool relative=true, void (*handler)()=nullptr, bool wake=true);
+    void enableAlarm(Time time, bool relative=true, Callback<> handler=nullptr, bool wake=true);
     void disableAlarm();
+    uint64_t counter();
+    void enablePeriodicInterrupt(uint8_t interval, Callback<> handler, bool wake=false);
+    void disablePeriodicInterrupt();
     inline volatile bool alarmPassed() { return *(volatile uint32_t*)(BASE + OFFSET_CV) >= *(volatile uint32_t*)(BASE + OFFSET_AR0); }
 
 }
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include "core.h"
+#include "callback.h"
 
 // Backup Power Manager
 // This module manages power-saving features
@@ -104,7 +105,7 @@ namespace BPM {
     void set32KHzClockSource(CLK32KSource source);
 
     // Interrupts
-    void enableInterrupt(void (*handler)(), Interrupt interrupt=Interrupt::PSOK);
+    void enableInterrupt(Callback<> handler, Interrupt interrupt=Interrupt::PSOK);
     void disableInterrupt(Interrupt interrupt=Interrupt::PSOK);
 
 }
@@ -0,0 +1,52 @@
+#ifndef _CALLBACK_H_
+#define _CALLBACK_H_
+
+// Callback
+// This is the type used by the drivers to store user handlers : a function pointer and a context
+// pointer which is given back to the function as its first argument. A single function can
+// therefore serve several instances (objects, ports, channels...) without having to recover its
+// context from a global variable or from the current interrupt number.
+// Plain functions without context are still accepted : the function pointer is stored in place of
+// the context and called through a trampoline, so the callback is always two words and a call is
+// always a single indirect branch (plus the trampoline for plain functions).
+// Examples, for a driver expecting a Callback<> :
+//     DMA::enableInterrupt(channel, transferFinished);                 // void transferFinished()
+//     DMA::enableInterrupt(channel, {transferFinished, &buffer});      // void transferFinished(void* context)
+//     DMA::enableInterrupt(channel, Callback<>::bind<Sensor, &Sensor::transferFinished>(&sensor));
+template<typename... Args>
+class Callback {
+public:
+    using Function = void (*)(void* context, Args... args);
+    using PlainFunction = void (*)(Args... args);
+
+    constexpr Callback() : _function(nullptr), _context(nullptr) {}
+    constexpr Callback(decltype(nullptr)) : _function(nullptr), _context(nullptr) {}
+    constexpr Callback(Function function, void* context) : _function(function), _context(context) {}
+    Callback(PlainFunction function)
+        : _function(function != nullptr ? callPlainFunction : nullptr),
+          _context(reinterpret_cast<void*>(function)) {}
+
+    // Create a callback which calls the given method on the given object
+    template<typename T, void (T::*Method)(Args...)>
+    static Callback bind(T* object) {
+        return Callback(callMethod<T, Method>, object);
+    }
+
+    inline void operator()(Args... args) const { _function(_context, args...); }
+    inline explicit operator bool() const { return _function != nullptr; }
+
+private:
+    Function _function;
+    void* _context;
+
+    static void callPlainFunction(void* context, Args... args) {
+        reinterpret_cast<PlainFunction>(context)(args...);
+    }
+
+    template<typename T, void (T::*Method)(Args...)>
+    static void callMethod(void* context, Args... args) {
+        (static_cast<T*>(context)->*Method)(args...);
+    }
+};
+
+#endif
@@ -25,6 +25,27 @@ namespace Core {
     // This array is used to store the NVIC ISERs (Interrupt Set-Enable Registers) when interrupts are stashed
     uint32_t _nvicStash[N_NVIC_IMPLEMENTED];
 
+    // Function called by yield(), set by the Kernel module
+    uint32_t _yieldHandler = 0;
+
+    // Number of times the CPU has woken up from sleep mode in waitForInterrupt()
+    volatile uint32_t _sleepCounter = 0;
+
+    // Function called by setInterruptHandler(), set by the Profiler module
+    uint32_t _interruptHandlerHook = 0;
+
+    // Deferred work queue. Interrupt handlers reserve a slot with an atomic increment of the head
+    // and mark it as ready once it is filled, and PendSV executes the ready slots in order from the tail.
+    struct DeferredWork {
+        uint32_t function;
+        uint32_t arg;
+        volatile bool ready;
+    };
+    DeferredWork _deferredQueue[DEFERRED_QUEUE_SIZE];
+    volatile uint32_t _deferredHead = 0;
+    volatile uint32_t _deferredTail = 0;
+    volatile unsigned int _deferredOverflows = 0;
+
 
     // Initialize the core components : exceptions/interrupts table, 
     // clocks, SysTick (system timer), ...
@@ -47,6 +68,10 @@ namespace Core {
         // Change the core vector pointer to the new table
         (*(volatile uint32_t*) VTOR) = (uint32_t) _isrVector;
 
+        // SHPR3 (System Handler Priority Register 3) : PendSV runs the deferred work queue, it must
+        // have the lowest priority so that it never delays an interrupt
+        (*(volatile uint32_t*) SHPR3) |= 0xFF << 16; // PRI_14 : PendSV
+
         // Enable the lower-priority faults
         (*(volatile uint32_t*) SHCSR)
             |= 1 << 16      // MEMFAULTENA : enable MemManage faults
@@ -161,9 +186,26 @@ namespace Core {
 
     // Set the handler for the specified interrupt
     void setInterruptHandler(Interrupt interrupt, void (*handler)()) {
+        // The hook can take over the handler, in which case the vector entry is left untouched
+        bool (*hook)(Interrupt, void (*)()) = (bool (*)(Interrupt, void (*)()))_interruptHandlerHook;
+        if (hook != nullptr && hook(interrupt, handler)) {
+            return;
+        }
         _isrVector[N_INTERNAL_EXCEPTIONS + static_cast<int>(interrupt)] = (uint32_t)handler;
     }
 
+    // Get the handler currently installed in the vector for the specified interrupt
+    void (*interruptHandler(Interrupt interrupt))() {
+        return (void (*)())_isrVector[N_INTERNAL_EXCEPTIONS + static_cast<int>(interrupt)];
+    }
+
+    // Set a function which is called every time a driver installs an interrupt handler. If the hook
+    // returns true, it has taken over the handler and the vector is not modified. This is used by
+    // the Profiler module to keep its instrumented entries in the vector.
+    void setInterruptHandlerHook(bool (*hook)(Interrupt interrupt, void (*handler)())) {
+        _interruptHandlerHook = (uint32_t)hook;
+    }
+
     // Enable the specified interrupt with the given priority
     void enableInterrupt(Interrupt interrupt, uint8_t priority) {
         // For ICPR and ISER : 
@@ -213,26 +255,85 @@ namespace Core {
     // section where only some selected interrupts can be triggered. Use applyStashedInterrupts()
     // to enable the interrupts as they were before.
     void stashInterrupts() {
-        disableInterrupts();
+        uint32_t primask = enterCriticalSection();
 
         for (int i = 0; i < N_NVIC_IMPLEMENTED; i++) {
             _nvicStash[i] = (*(volatile uint32_t*) (NVIC_ISER0 + i * sizeof(uint32_t)));
             (*(volatile uint32_t*) (NVIC_ICER0 + i * sizeof(uint32_t))) = 0xFFFFFFFF;
         }
 
-        enableInterrupts();
+        exitCriticalSection(primask);
     }
 
     // Re-enable stashed interrupts. Note that this will not disable interrupts that were
     // manually enabled after stashInterrupts()
     void applyStashedInterrupts() {
-        disableInterrupts();
+        uint32_t primask = enterCriticalSection();
 
         for (int i = 0; i < N_NVIC_IMPLEMENTED; i++) {
             (*(volatile uint32_t*) (NVIC_ISER0 + i * sizeof(uint32_t))) = _nvicStash[i];
         }
 
-        enableInterrupts();
+        exitCriticalSection(primask);
+    }
+
+    // Post a work item from an interrupt handler : work(arg) will be called in order with the other
+    // items, from PendSV, once every interrupt has been handled. This keeps the slow part of a
+    // handler from delaying the other interrupts. This function does not disable interrupts, it can
+    // be called concurrently from handlers of different priorities. Return false if the queue is full.
+    bool defer(void (*work)(uint32_t), uint32_t arg) {
+        // Reserve a slot (compiled to LDREX/STREX)
+        uint32_t head = _deferredHead;
+        do {
+            if (head - _deferredTail >= DEFERRED_QUEUE_SIZE) {
+                __atomic_fetch_add(&_deferredOverflows, 1, __ATOMIC_RELAXED);
+                return false;
+            }
+        } while (!__atomic_compare_exchange_n(&_deferredHead, &head, head + 1, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+        // Fill the slot and publish it
+        DeferredWork& item = _deferredQueue[head & (DEFERRED_QUEUE_SIZE - 1)];
+        item.function = (uint32_t)work;
+        item.arg = arg;
+        __atomic_store_n(&item.ready, true, __ATOMIC_RELEASE);
+
+        // ICSR (Interrupt Control and State Register) : set PendSV as pending
+        (*(volatile uint32_t*) ICSR) = 1 << ICSR_PENDSVSET;
+        return true;
+    }
+
+    void callHandler(uint32_t handler) {
+        ((void (*)())handler)();
+    }
+
+    // Post a work item without argument
+    bool defer(void (*work)()) {
+        return defer(callHandler, (uint32_t)work);
+    }
+
+    // Execute the pending work items. This is called by PendSV and must not be called elsewhere.
+    // Items posted while the queue is being drained are executed in the same pass.
+    void runDeferredWork() {
+        while (1) {
+            DeferredWork& item = _deferredQueue[_deferredTail & (DEFERRED_QUEUE_SIZE - 1)];
+            if (!__atomic_load_n(&item.ready, __ATOMIC_ACQUIRE)) {
+                // Either the queue is empty, or the next slot is still being filled by an interrupt
+                // handler, which will pend PendSV again when it is done
+                break;
+            }
+            void (*work)(uint32_t) = (void (*)(uint32_t))item.function;
+            uint32_t arg = item.arg;
+
+            // Free the slot before calling the item, which may post new work
+            item.ready = false;
+            __atomic_store_n(&_deferredTail, _deferredTail + 1, __ATOMIC_RELEASE);
+            work(arg);
+        }
+    }
+
+    // Number of work items lost because the queue was full
+    unsigned int deferredOverflowCounter() {
+        return _deferredOverflows;
     }
 
     Interrupt currentInterrupt() {
@@ -241,15 +342,20 @@ namespace Core {
         return static_cast<Interrupt>(((*(volatile uint32_t*) ICSR) & 0x1FF) - N_INTERNAL_EXCEPTIONS);
     }
 
-    // Sleep for a specified amount of time
-    void sleep(SleepMode mode, unsigned long length, TimeUnit unit, bool (*cbExit)()) {
-        // Select the correct sleep mode
+    // Select the mode the chip will enter on the next WFI instruction
+    void setSleepMode(SleepMode mode) {
         if (mode >= SleepMode::SLEEP0 && mode <= SleepMode::SLEEP3) {
             *(volatile uint32_t*) SCR &= ~(uint32_t)(1 << SCR_SLEEPDEEP);
         } else {
             *(volatile uint32_t*) SCR |= 1 << SCR_SLEEPDEEP;
         }
         BPM::setSleepMode(mode);
+    }
+
+    // Sleep for a specified amount of time
+    void sleep(SleepMode mode, unsigned long length, TimeUnit unit, bool (*cbExit)()) {
+        // Select the correct sleep mode
+        setSleepMode(mode);
 
         // The length is optional, if not specified the chip will sleep until an event
         // wakes it up. See PM::enableWakeUpSource() and BPM::enableBackupWakeUpSource().
@@ -269,14 +375,14 @@ namespace Core {
                 // This special ARM instruction can put the chip in sleep mode until
                 // an interrupt with a sufficient priority is triggered
                 // See §B1.5.17 Power Management in the ARMv7-M Architecture Reference Manual
-                __asm__ __volatile__("WFI");
+                waitForInterrupt();
             }
 
         } else {
             // Wait until any known interrupt is triggered
             do {
                 // See comment about WFI above
-                __asm__ __volatile__("WFI");
+                waitForInterrupt();
             } while (PM::isWakeUpCauseUnknown());
         }
     }
@@ -302,6 +408,33 @@ namespace Core {
         *(volatile uint32_t*) SYST_CSR = 0;
     }
 
+    // Enable the DWT cycle counter, which counts the CPU clock cycles and wraps around
+    // every 2^32 cycles. It is shared by the Profiler and Monotonic modules and is never
+    // reset, so that they can both use it. The counter stops when the CPU clock is stopped, i.e.
+    // during waitForInterrupt() : see sleepCounter().
+    void enableCycleCounter() {
+        // DEMCR (Debug Exception and Monitor Control Register) : enable the DWT and ITM units
+        (*(volatile uint32_t*) DEMCR) |= 1 << DEMCR_TRCENA;
+
+        // CTRL (Control Register) : enable the counter
+        (*(volatile uint32_t*) DWT_CTRL) |= 1 << DWT_CTRL_CYCCNTENA;
+    }
+
+    // Set the function called by yield(). This is used by the Kernel module to switch
+    // to another thread while a driver is waiting for a peripheral.
+    void setYieldHandler(void (*handler)()) {
+        _yieldHandler = (uint32_t)handler;
+    }
+
+    // Let another thread run, if a scheduler is installed. Drivers call this in their
+    // polling loops ; without a scheduler, this returns immediately.
+    void yield() {
+        void (*handler)() = (void (*)())_yieldHandler;
+        if (handler != nullptr) {
+            handler();
+        }
+    }
+
     // Waste CPU clock cycles to wait for a specified amount of time
     void waitMicroseconds(unsigned long length) {
         // Save the last CVR (Current Value Register) value at each loop iteration
@@ -367,7 +500,7 @@ namespace Core {
     }
 
     void handlerPendSV() {
-        while (1);
+        runDeferredWork();
     }
 
     void handlerSysTick() {
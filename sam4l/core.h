@@ -46,6 +46,8 @@ namespace Core {
     // Peripheral Debug
     const uint32_t PDBG = 0xE0042000;  // Peripheral Debug Register
     const uint32_t DEMCR = 0xE000EDFC; // Debug Exception and Monitor Control Register
+    const uint32_t DWT_CTRL = 0xE0001000;   // DWT (Data Watchpoint and Trace) Control Register
+    const uint32_t DWT_CYCCNT = 0xE0001004; // DWT Cycle Count Register
 
     // ChipID and Serial number
     const uint32_t CHIPID_CIDR = 0x400E0740;
@@ -55,6 +57,7 @@ namespace Core {
 
 
     // Subregisters
+    const uint32_t ICSR_PENDSVSET = 28; // Set the PendSV exception as pending
     const uint32_t SCR_SLEEPONEXIT = 1; // Enter sleep state when no interrupt is being handled
     const uint32_t SCR_SLEEPDEEP = 2; // Select between sleep and wait/retention/backup mode
     const uint32_t SYST_CSR_ENABLE = 0; // SysTick enabled
@@ -66,6 +69,8 @@ namespace Core {
     const uint32_t PDBG_WDT = 0; // Freeze WDT when Core is halted in debug mode
     const uint32_t PDBG_AST = 1; // Freeze AST when Core is halted in debug mode
     const uint32_t PDBG_PEVC = 2; // Freeze PEVX when Core is halted in debug mode
+    const uint32_t DEMCR_TRCENA = 24; // Enable the DWT and ITM units
+    const uint32_t DWT_CTRL_CYCCNTENA = 0; // Enable the cycle counter
     const uint32_t CHIPID_CIDR_NVPSIZ = 8; // Flash size
     const uint32_t CHIPID_CIDR_SRAMSIZ = 16; // RAM size
     const uint32_t CHIPID_CIDR_EXT = 31; // Extension flag
@@ -96,6 +101,9 @@ namespace Core {
         SYSTICK = 15,
     };
 
+    // Deferred work queue (the size must be a power of 2)
+    const int DEFERRED_QUEUE_SIZE = 32;
+
     // Interrupts
     const int N_EXTERNAL_INTERRUPTS = 80;
     enum class Interrupt {
@@ -234,22 +242,86 @@ namespace Core {
     // Interrupts
     void setExceptionHandler(Exception exception, void (*handler)());
     void setInterruptHandler(Interrupt interrupt, void (*handler)());
+    void (*interruptHandler(Interrupt interrupt))();
+    void setInterruptHandlerHook(bool (*hook)(Interrupt interrupt, void (*handler)()));
     void enableInterrupt(Interrupt interrupt, uint8_t priority);
     void disableInterrupt(Interrupt interrupt);
     inline void enableInterrupts() { __asm__("CPSIE I"); } // Change Program State Interrupt Enable
     inline void disableInterrupts() { __asm__("CPSID I"); } // Change Program State Interrupt Disable
+    inline uint32_t enterCriticalSection() { // Disable interrupts and return the previous state of PRIMASK
+        uint32_t primask;
+        __asm__ __volatile__("MRS %0, PRIMASK\n\tCPSID I" : "=r" (primask) :: "memory");
+        return primask;
+    }
+    inline void exitCriticalSection(uint32_t primask) { // Restore PRIMASK as it was before enterCriticalSection()
+        __asm__ __volatile__("MSR PRIMASK, %0" :: "r" (primask) : "memory");
+    }
     void setInterruptPriority(Interrupt interrupt, uint8_t priority);
     void stashInterrupts();
     void applyStashedInterrupts();
     Interrupt currentInterrupt();
+    template<void (*HANDLER)(int), int N_INSTANCES>
+    void setInterruptHandler(Interrupt interrupt, int instance);
+    bool defer(void (*work)(uint32_t), uint32_t arg=0);
+    bool defer(void (*work)());
+    void runDeferredWork();
+    unsigned int deferredOverflowCounter();
 
     // Time and power related functions
     inline Time time() { return AST::time(); }
     void sleep(unsigned long length, TimeUnit unit=TimeUnit::MILLISECONDS, bool (*cbExit)()=nullptr);
     void sleep(SleepMode mode=SleepMode::SLEEP0, unsigned long length=0, TimeUnit unit=TimeUnit::MILLISECONDS, bool (*cbExit)()=nullptr);
+    void setSleepMode(SleepMode mode);
     void waitMicroseconds(unsigned long length);
+    void enableCycleCounter();
+    inline uint32_t cycles() { return (*(volatile uint32_t*) DWT_CYCCNT); }
+    extern volatile uint32_t _sleepCounter;
+    inline void waitForInterrupt() { // Count the sleeps, since the cycle counter stops while sleeping
+        // The counter is incremented after WFI with interrupts masked : WFI still wakes up on a pending
+        // interrupt, whose handler only runs once the counter has been updated
+        uint32_t primask = enterCriticalSection();
+        __asm__ __volatile__("WFI" ::: "memory");
+        _sleepCounter = _sleepCounter + 1;
+        exitCriticalSection(primask);
+    }
+    inline uint32_t sleepCounter() { return _sleepCounter; }
     void enableSysTick();
     void disableSysTick();
+    void setYieldHandler(void (*handler)());
+    void yield();
+
+    // Vector table entry generated at compile time for an instance of a peripheral (a channel,
+    // a port...) : it calls HANDLER(INSTANCE) directly, so the handler does not have to find its
+    // instance through currentInterrupt() and a lookup table. Since the vector table is in RAM,
+    // drivers can install these entries with setInterruptHandler<HANDLER, N_INSTANCES>().
+    template<void (*HANDLER)(int), int INSTANCE>
+    void instanceHandler() {
+        HANDLER(INSTANCE);
+    }
+
+    // Select the entry of an instance known only at runtime. This is a chain of comparisons,
+    // which is only executed when the handler is installed.
+    template<void (*HANDLER)(int), int N_INSTANCES>
+    struct InstanceHandlers {
+        static void (*get(int instance))() {
+            if (instance == N_INSTANCES - 1) {
+                return instanceHandler<HANDLER, N_INSTANCES - 1>;
+            }
+            return InstanceHandlers<HANDLER, N_INSTANCES - 1>::get(instance);
+        }
+    };
+
+    template<void (*HANDLER)(int)>
+    struct InstanceHandlers<HANDLER, 0> {
+        static void (*get(int))() {
+            return nullptr;
+        }
+    };
+
+    template<void (*HANDLER)(int), int N_INSTANCES>
+    void setInterruptHandler(Interrupt interrupt, int instance) {
+        setInterruptHandler(interrupt, InstanceHandlers<HANDLER, N_INSTANCES>::get(instance));
+    }
 
     // Default exception handlers
     void handlerNMI();
@@ -10,6 +10,15 @@ namespace DAC {
     bool _enabled = false;
     int _dmaChannel = -1;
 
+    // Streaming
+    volatile bool _streamRunning = false;
+    uint16_t* _streamBuffer = nullptr;
+    int _streamHalfSize = 0;
+    int _streamNextHalf = 0;
+    uint32_t _streamHandler = 0;
+    volatile unsigned int _streamUnderruns = 0;
+    void streamReloadHandler();
+
     // Enable the DAC controller
     void enable() {
         // Enable the clock
@@ -47,6 +56,9 @@ namespace DAC {
 
     // Disable the DAC controller and free ressources
     void disable() {
+        // Stop the stream
+        stopStream();
+
         // WPMR (Write Protect Mode Register) : unlock the MR register
         (*(volatile uint32_t*)(DAC_BASE + OFFSET_WPMR))
             = WPMR_WPKEY
@@ -58,8 +70,16 @@ namespace DAC {
         // Free the pin
         GPIO::disablePeripheral(PIN_VOUT);
 
+        // Release the DMA channel
+        if (_dmaChannel > -1) {
+            DMA::freeChannel(_dmaChannel);
+            _dmaChannel = -1;
+        }
+
         // Disable the clock
         PM::disablePeripheralClock(PM::CLK_DAC);
+
+        _enabled = false;
     }
 
     void write(uint16_t value) {
@@ -106,6 +126,95 @@ namespace DAC {
         }
     }
 
+    // Start a continuous stream using the given buffer as a double buffer : while the DMA plays one
+    // half, the handler is called (from the DMA interrupt) to fill the other half. The handler must
+    // return the number of samples written, up to n ; returning 0 ends the stream once the samples
+    // already queued have been played. If the handler does not return before the DMA runs out of
+    // samples, the output is restarted and the underrun is counted.
+    bool startStream(uint16_t* buffer, int size, int (*handler)(uint16_t* samples, int n)) {
+        // Enable the DAC controller if it is not already
+        if (!_enabled) {
+            enable();
+        }
+        if (handler == nullptr || size < 2) {
+            return false;
+        }
+
+        // Stop any previous operation
+        stopStream();
+        DMA::stopChannel(_dmaChannel);
+        DMA::disableRing(_dmaChannel);
+
+        _streamBuffer = buffer;
+        _streamHalfSize = size / 2;
+        _streamNextHalf = 0;
+        _streamHandler = (uint32_t)handler;
+        _streamUnderruns = 0;
+
+        // Ask for both halves before starting
+        int n0 = handler(_streamBuffer, _streamHalfSize);
+        if (n0 <= 0) {
+            return false;
+        }
+        int n1 = handler(_streamBuffer + _streamHalfSize, _streamHalfSize);
+        _streamRunning = true;
+        DMA::startChannel(_dmaChannel, (uint32_t)_streamBuffer, n0);
+        if (n1 > 0) {
+            DMA::reloadChannel(_dmaChannel, (uint32_t)(_streamBuffer + _streamHalfSize), n1);
+            DMA::enableInterrupt(_dmaChannel, streamReloadHandler, DMA::Interrupt::RELOAD_EMPTY);
+        } else {
+            _streamRunning = false;
+        }
+        return true;
+    }
+
+    // Stop calling the handler : the samples already queued are still played, call stop() to
+    // interrupt the output immediately
+    void stopStream() {
+        if (_streamRunning) {
+            DMA::disableInterrupt(_dmaChannel, DMA::Interrupt::RELOAD_EMPTY);
+            _streamRunning = false;
+        }
+    }
+
+    bool isStreamRunning() {
+        return _streamRunning;
+    }
+
+    unsigned int underrunCounter() {
+        return _streamUnderruns;
+    }
+
+    void streamReloadHandler() {
+        // The half which was just played is free : the DMA is now working on the other half
+        uint16_t* half = _streamBuffer + _streamNextHalf * _streamHalfSize;
+        _streamNextHalf = !_streamNextHalf;
+
+        // Ask the user to fill it
+        int (*handler)(uint16_t*, int) = (int (*)(uint16_t*, int))_streamHandler;
+        int n = handler(half, _streamHalfSize);
+        if (n <= 0) {
+            // End of the stream : the reload register stays empty, which would keep triggering this interrupt
+            DMA::disableInterrupt(_dmaChannel, DMA::Interrupt::RELOAD_EMPTY);
+            _streamRunning = false;
+            return;
+        }
+        if (n > _streamHalfSize) {
+            n = _streamHalfSize;
+        }
+
+        if (DMA::isFinished(_dmaChannel)) {
+            // Underrun : the other half has already been played entirely and the output has stopped.
+            // Restart it with this half, the interrupt will be triggered again immediately to ask for
+            // the next one.
+            _streamUnderruns++;
+            DMA::startChannel(_dmaChannel, (uint32_t)half, n);
+        } else {
+            // Queue this half after the current one, which also clears the interrupt
+            DMA::reloadChannel(_dmaChannel, (uint32_t)half, n);
+        }
+    }
+
     void reload(uint16_t* buffer, int n) {
         // Enable the DAC controller if it is not already
         if (!_enabled) {
@@ -122,7 +231,8 @@ namespace DAC {
             enable();
         }
         
-        // Stop the DMA
+        // Stop the stream and the DMA
+        stopStream();
         DMA::stopChannel(_dmaChannel);
     }
 
@@ -178,7 +288,7 @@ namespace DAC {
         return true;
     }
 
-    void enableInterrupt(void (*handler)(), Interrupt interrupt) {
+    void enableInterrupt(Callback<> handler, Interrupt interrupt) {
         // Enable the DAC controller if it is not already
         if (!_enabled) {
             enable();
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include "gpio.h"
+#include "callback.h"
 
 // Digital to Analog Converter
 // This module is used to generate an analog voltage on a pin
@@ -49,10 +50,16 @@ namespace DAC {
     bool setFrequency(unsigned long frequency);
     bool isFinished();
     bool isReloadEmpty();
-    void enableInterrupt(void (*handler)(), Interrupt interrupt=Interrupt::TRANSFER_FINISHED);
+    void enableInterrupt(Callback<> handler, Interrupt interrupt=Interrupt::TRANSFER_FINISHED);
     void disableInterrupt(Interrupt interrupt=Interrupt::TRANSFER_FINISHED);
     void setPin(GPIO::Pin pin);
 
+    // Streaming
+    bool startStream(uint16_t* buffer, int size, int (*handler)(uint16_t* samples, int n));
+    void stopStream();
+    bool isStreamRunning();
+    unsigned int underrunCounter();
+
 }
 
 
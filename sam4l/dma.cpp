@@ -5,27 +5,41 @@
 
 namespace DMA {
 
-    // Current number of channels
-    int _nChannels = 0;
-
     ChannelConfig _channels[N_CHANNELS_MAX];
 
     // Interrupt handlers
     extern uint8_t INTERRUPT_PRIORITY;
-    uint32_t _interruptHandlers[N_CHANNELS_MAX][N_INTERRUPTS];
+    Callback<> _interruptHandlers[N_CHANNELS_MAX][N_INTERRUPTS];
     const int _interruptBits[N_INTERRUPTS] = {ISR_RCZ, ISR_TRC, ISR_TERR};
-    void interruptHandlerWrapper();
+    void interruptHandler(int channel);
+
+    // Internal function which checks that a channel has been allocated
+    inline bool checkChannel(int channel) {
+        if (channel < 0 || channel >= N_CHANNELS_MAX || !_channels[channel].allocated) {
+            Error::happened(Error::Module::DMA, ERR_CHANNEL_NOT_INITIALIZED, Error::Severity::CRITICAL);
+            return false;
+        }
+        return true;
+    }
+
+    int newChannel(Device device, Size size, uint32_t address, uint16_t length, bool ring, Priority priority) {
+        // Look for a free channel : from the lowest number for high-priority channels, and from
+        // the highest number for low-priority channels
+        int n = -1;
+        for (int i = 0; i < N_CHANNELS_MAX; i++) {
+            int channel = (priority == Priority::HIGH ? i : N_CHANNELS_MAX - 1 - i);
+            if (!_channels[channel].allocated) {
+                n = channel;
+                break;
+            }
+        }
 
-    int newChannel(Device device, Size size, uint32_t address, uint16_t length, bool ring) {
         // Check that there is an available channel
-        if (_nChannels == N_CHANNELS_MAX) {
+        if (n == -1) {
             Error::happened(Error::Module::DMA, ERR_NO_CHANNEL_AVAILABLE, Error::Severity::CRITICAL);
             return -1;
         }
-
-        // Channel number : take the last channel
-        int n = _nChannels;
-        _nChannels++;
+        _channels[n].allocated = true;
 
         // Setup the chosen channel
         setupChannel(n, device, size, address, length, ring);
@@ -34,10 +48,13 @@ namespace DMA {
     }
 
     // Create a channel or reuse an existing one
-    int setupChannel(int channel, Device device, Size size, uint32_t address, uint16_t length, bool ring) {
+    int setupChannel(int channel, Device device, Size size, uint32_t address, uint16_t length, bool ring, Priority priority) {
         // If the given channel is negative, create a new one
         if (channel < 0) {
-            return newChannel(device, size, address, length, ring);
+            return newChannel(device, size, address, length, ring, priority);
+        }
+        if (!checkChannel(channel)) {
+            return -1;
         }
 
         const uint32_t REG_BASE = BASE + channel * CHANNEL_REG_SIZE;
@@ -68,9 +85,44 @@ namespace DMA {
         return channel;
     }
 
-    void enableInterrupt(int channel, void (*handler)(), Interrupt interrupt) {
+    // Stop a channel and release it so that it can be allocated again by newChannel()
+    void freeChannel(int channel) {
+        if (!checkChannel(channel)) {
+            return;
+        }
+        const uint32_t REG_BASE = BASE + channel * CHANNEL_REG_SIZE;
+
+        // Stop the transfer
+        stopChannel(channel);
+
+        // IDR (Interrupt Disable Register) : disable every interrupt
+        (*(volatile uint32_t*)(REG_BASE + OFFSET_IDR)) = 1 << ISR_RCZ | 1 << ISR_TRC | 1 << ISR_TERR;
+        Core::disableInterrupt(static_cast<Core::Interrupt>(static_cast<int>(Core::Interrupt::DMA0) + channel));
+        for (int i = 0; i < N_INTERRUPTS; i++) {
+            _interruptHandlers[channel][i] = nullptr;
+        }
+
+        // Reset the channel
+        (*(volatile uint32_t*)(REG_BASE + OFFSET_MR)) = 0;
+        (*(volatile uint32_t*)(REG_BASE + OFFSET_TCRR)) = 0;
+        _channels[channel].interruptsEnabled = false;
+        _channels[channel].allocated = false;
+    }
+
+    // Return the number of channels that can still be allocated
+    int getNumberOfFreeChannels() {
+        int n = 0;
+        for (int i = 0; i < N_CHANNELS_MAX; i++) {
+            if (!_channels[i].allocated) {
+                n++;
+            }
+        }
+        return n;
+    }
+
+    void enableInterrupt(int channel, Callback<> handler, Interrupt interrupt) {
         // Save the user handler
-        _interruptHandlers[channel][static_cast<int>(interrupt)] = (uint32_t)handler;
+        _interruptHandlers[channel][static_cast<int>(interrupt)] = handler;
 
         // IER (Interrupt Enable Register) : enable the requested interrupt
         (*(volatile uint32_t*)(BASE + channel * CHANNEL_REG_SIZE + OFFSET_IER))
@@ -78,7 +130,7 @@ namespace DMA {
 
         // Enable the interrupt in the NVIC
         Core::Interrupt interruptChannel = static_cast<Core::Interrupt>(static_cast<int>(Core::Interrupt::DMA0) + channel);
-        Core::setInterruptHandler(interruptChannel, interruptHandlerWrapper);
+        Core::setInterruptHandler<interruptHandler, N_CHANNELS_MAX>(interruptChannel, channel);
         Core::enableInterrupt(interruptChannel, INTERRUPT_PRIORITY);
         _channels[channel].interruptsEnabled = true;
     }
@@ -97,8 +149,7 @@ namespace DMA {
 
     void setupChannel(int channel, uint32_t address, uint16_t length) {
         // Check that this channel exists
-        if (channel >= _nChannels) {
-            Error::happened(Error::Module::DMA, ERR_CHANNEL_NOT_INITIALIZED, Error::Severity::CRITICAL);
+        if (!checkChannel(channel)) {
             return;
         }
         
@@ -115,8 +166,7 @@ namespace DMA {
 
     void startChannel(int channel) {
         // Check that this channel exists
-        if (channel >= _nChannels) {
-            Error::happened(Error::Module::DMA, ERR_CHANNEL_NOT_INITIALIZED, Error::Severity::CRITICAL);
+        if (!checkChannel(channel)) {
             return;
         }
 
@@ -139,8 +189,7 @@ namespace DMA {
 
     void reloadChannel(int channel, uint32_t address, uint16_t length) {
         // Check that this channel exists
-        if (channel >= _nChannels) {
-            Error::happened(Error::Module::DMA, ERR_CHANNEL_NOT_INITIALIZED, Error::Severity::CRITICAL);
+        if (!checkChannel(channel)) {
             return;
         }
 
@@ -158,8 +207,7 @@ namespace DMA {
 
     void stopChannel(int channel) {
         // Check that this channel exists
-        if (channel >= _nChannels) {
-            Error::happened(Error::Module::DMA, ERR_CHANNEL_NOT_INITIALIZED, Error::Severity::CRITICAL);
+        if (!checkChannel(channel)) {
             return;
         }
         
@@ -208,17 +256,16 @@ namespace DMA {
     }
 
 
-    void interruptHandlerWrapper() {
-        // Get the channel number through the current interrupt number
-        int channel = static_cast<int>(Core::currentInterrupt()) - static_cast<int>(Core::Interrupt::DMA0);
+    // Interrupt handler of each channel, installed directly in the vector table
+    void interruptHandler(int channel) {
         const uint32_t REG_BASE = BASE + channel * CHANNEL_REG_SIZE;
 
         // Call the user handler of every interrupt that is enabled and pending
         for (int i = 0; i < N_INTERRUPTS; i++) {
             if ((*(volatile uint32_t*)(REG_BASE + OFFSET_IMR)) & (1 << _interruptBits[i]) // Interrupt is enabled
                     && (*(volatile uint32_t*)(REG_BASE + OFFSET_ISR)) & (1 << _interruptBits[i])) { // Interrupt is pending
-                void (*handler)() = (void (*)())_interruptHandlers[channel][i];
-                if (handler != nullptr) {
+                const Callback<>& handler = _interruptHandlers[channel][i];
+                if (handler) {
                     handler();
                 }
 
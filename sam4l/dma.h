@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include "error.h"
+#include "callback.h"
 
 // Direct Memory Access
 // This module is able to automatically copy data between RAM and peripherals,
@@ -70,6 +71,7 @@ namespace DMA {
         I2C3_M_RX = 8,
         I2C0_S_RX = 9,
         I2C1_S_RX = 10,
+        ADC_RX = 11,
         USART0_TX = 18,
         USART1_TX = 19,
         USART2_TX = 20,
@@ -81,10 +83,20 @@ namespace DMA {
         I2C3_M_TX = 26,
         I2C0_S_TX = 27,
         I2C1_S_TX = 28,
+        ADC_TX = 29,
         DAC = 35
     };
 
+    // Channel priority : the PDCA arbitrates pending requests by channel number, the lowest
+    // number having the highest priority. High-priority channels are allocated from the bottom
+    // of the channel list, low-priority channels from the top.
+    enum class Priority {
+        HIGH,
+        LOW
+    };
+
     struct ChannelConfig {
+        bool allocated;
         bool started;
         bool interruptsEnabled;
     };
@@ -92,9 +104,11 @@ namespace DMA {
     const int N_CHANNELS_MAX = 16;
 
     // Module API
-    int newChannel(Device device, Size size, uint32_t address=0x00000000, uint16_t length=0, bool ring=false);
-    int setupChannel(int channel, Device device, Size size, uint32_t address=0x00000000, uint16_t length=0, bool ring=false);
-    void enableInterrupt(int channel, void (*handler)(), Interrupt interrupt=Interrupt::TRANSFER_FINISHED);
+    int newChannel(Device device, Size size, uint32_t address=0x00000000, uint16_t length=0, bool ring=false, Priority priority=Priority::LOW);
+    int setupChannel(int channel, Device device, Size size, uint32_t address=0x00000000, uint16_t length=0, bool ring=false, Priority priority=Priority::LOW);
+    void freeChannel(int channel);
+    int getNumberOfFreeChannels();
+    void enableInterrupt(int channel, Callback<> handler, Interrupt interrupt=Interrupt::TRANSFER_FINISHED);
     void disableInterrupt(int channel, Interrupt interrupt=Interrupt::TRANSFER_FINISHED);
     void setupChannel(int channel, uint32_t address, uint16_t length);
     void startChannel(int channel);
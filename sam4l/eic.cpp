@@ -14,11 +14,11 @@ namespace EIC {
     // Handlers defined by the user
     extern uint8_t INTERRUPT_PRIORITY;
     bool _initialized = false;
-    uint32_t _interruptHandlers[N_CHANNELS - 1]; // -1 because channel 0 is the NMI
+    Callback<int> _interruptHandlers[N_CHANNELS - 1]; // -1 because channel 0 is the NMI
 
     // Internal functions
     void init();
-    void handlerWrapper();
+    void interruptHandler(int channel);
 
 
     void setPin(Channel channel, GPIO::Pin pin) {
@@ -26,10 +26,12 @@ namespace EIC {
     }
 
     void init() {
-        memset(_interruptHandlers, 0, sizeof(_interruptHandlers));
+        for (int i = 0; i < N_CHANNELS - 1; i++) {
+            _interruptHandlers[i] = nullptr;
+        }
     }
 
-    void enableInterrupt(Channel channel, Mode mode, Polarity polarity, void (*handler)(int), bool filter) {
+    void enableInterrupt(Channel channel, Mode mode, Polarity polarity, Callback<int> handler, bool filter) {
         // Init the module if necessary
         if (!_initialized) {
             init();
@@ -79,9 +81,9 @@ namespace EIC {
 
         // Set the handler and enable the module interrupt at the Core level, except for the NMI
         if (channel > 0) {
-            _interruptHandlers[channel - 1] = (uint32_t)handler;
+            _interruptHandlers[channel - 1] = handler;
             Core::Interrupt interrupt = static_cast<Core::Interrupt>(static_cast<int>(Core::Interrupt::EIC1) + channel - 1);
-            Core::setInterruptHandler(interrupt, handlerWrapper);
+            Core::setInterruptHandler<interruptHandler, N_CHANNELS>(interrupt, static_cast<int>(channel));
             Core::enableInterrupt(interrupt, INTERRUPT_PRIORITY);
         }
 
@@ -92,7 +94,7 @@ namespace EIC {
         (*(volatile uint32_t*)(BASE + OFFSET_EN)) = 1 << channel;
     }
 
-    void enableAsyncInterrupt(Channel channel, Polarity polarity, void (*handler)(int)) {
+    void enableAsyncInterrupt(Channel channel, Polarity polarity, Callback<int> handler) {
         // Init the module if necessary
         if (!_initialized) {
             init();
@@ -124,9 +126,9 @@ namespace EIC {
 
         // Set the handler and enable the module interrupt at the Core level, except for the NMI
         if (channel > 0) {
-            _interruptHandlers[channel - 1] = (uint32_t)handler;
+            _interruptHandlers[channel - 1] = handler;
             Core::Interrupt interrupt = static_cast<Core::Interrupt>(static_cast<int>(Core::Interrupt::EIC1) + channel - 1);
-            Core::setInterruptHandler(interrupt, handlerWrapper);
+            Core::setInterruptHandler<interruptHandler, N_CHANNELS>(interrupt, static_cast<int>(channel));
             Core::enableInterrupt(interrupt, INTERRUPT_PRIORITY);
         }
 
@@ -169,15 +171,12 @@ namespace EIC {
         (*(volatile uint32_t*)(BASE + OFFSET_ICR)) = 1 << channel;
     }
 
-    // This wrapper is called when an interrupt is triggered and is used to clear the interrupt
-    // and call a user handler if defined
-    void handlerWrapper() {
-        // Channel that triggered the interrupt
-        int channel = static_cast<int>(Core::currentInterrupt()) - static_cast<int>(Core::Interrupt::EIC1) + 1;
-
+    // This handler is installed in the vector table for each channel when an interrupt is enabled,
+    // and is used to clear the interrupt and call a user handler if defined
+    void interruptHandler(int channel) {
         // Call the user handler for this interrupt
-        void (*handler)(int) = (void (*)(int))_interruptHandlers[channel - 1];
-        if (handler != nullptr) {
+        const Callback<int>& handler = _interruptHandlers[channel - 1];
+        if (handler) {
             handler(channel);
         }
         
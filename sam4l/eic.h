@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include "gpio.h"
 #include "error.h"
+#include "callback.h"
 
 // External Interrupt Controller
 // This module manages synchronous and asynchronous interrupts
@@ -52,8 +53,8 @@ namespace EIC {
 
     // Module API
     void setPin(Channel channel, GPIO::Pin pin);
-    void enableInterrupt(Channel channel, Mode mode, Polarity polarity, void (*handler)(int), bool filter=true);
-    void enableAsyncInterrupt(Channel channel, Polarity polarity, void (*handler)(int)=nullptr);
+    void enableInterrupt(Channel channel, Mode mode, Polarity polarity, Callback<int> handler, bool filter=true);
+    void enableAsyncInterrupt(Channel channel, Polarity polarity, Callback<int> handler=nullptr);
     void disableInterrupt(Channel channel);
     void clearInterrupt(Channel channel);
 
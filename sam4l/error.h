@@ -24,6 +24,9 @@ namespace Error {
         EIC,
         USB,
         CRC,
+        MEMORY,
+        KERNEL,
+        PROFILER,
         CUSTOM
     };
 
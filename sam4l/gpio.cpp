@@ -6,17 +6,19 @@
 namespace GPIO {
 
     extern uint8_t INTERRUPT_PRIORITY;
-    uint32_t _interruptHandlers[N_GPIO_LINES];
+    Callback<> _interruptHandlers[N_GPIO_LINES];
     uint32_t _portsState[N_PORTS];
 
     // Internal functions
-    void interruptHandlerWrapper();
+    void interruptHandler(int channel);
 
 
     // Internal initialization function. This is called in Core::init() and doesn't have to
     // be called by the user.
     void init() {
-        memset(_interruptHandlers, 0, sizeof(_interruptHandlers));
+        for (int i = 0; i < N_GPIO_LINES; i++) {
+            _interruptHandlers[i] = nullptr;
+        }
         memset(_portsState, 0, sizeof(_portsState));
     }
 
@@ -71,6 +73,63 @@ namespace GPIO {
         ((volatile RSCT_REG*)(REG_BASE + OFFSET_GPER))->SET = 1 << pin.number;
     }
 
+    void enableInput(const PinGroup& group, Pulling pulling) {
+        if (group.port == Port::UNDEFINED) {
+            Error::happened(Error::Module::GPIO, ERR_INVALID_PIN_GROUP, Error::Severity::CRITICAL);
+            return;
+        }
+
+        // Base register offset of this port
+        const uint32_t REG_BASE = GPIO_BASE + static_cast<uint8_t>(group.port) * PORT_REG_SIZE;
+
+        // ODER (Output Driver Enable Register) : set the pins as input
+        ((volatile RSCT_REG*)(REG_BASE + OFFSET_ODER))->CLEAR = group.mask;
+
+        // STER (Schmitt Trigger Enable Register) : enable the pins input Schmitt trigger (mandatory)
+        ((volatile RSCT_REG*)(REG_BASE + OFFSET_STER))->SET = group.mask;
+
+        // PUER and PDER (Pull-Up/Pull-Down Enable Registers) : see setPulling()
+        bool pullup = pulling == Pulling::PULLUP || pulling == Pulling::BUSKEEPER;
+        bool pulldown = pulling == Pulling::PULLDOWN || pulling == Pulling::BUSKEEPER;
+        if (pullup) {
+            ((volatile RSCT_REG*)(REG_BASE + OFFSET_PUER))->SET = group.mask;
+        } else {
+            ((volatile RSCT_REG*)(REG_BASE + OFFSET_PUER))->CLEAR = group.mask;
+        }
+        if (pulldown) {
+            ((volatile RSCT_REG*)(REG_BASE + OFFSET_PDER))->SET = group.mask;
+        } else {
+            ((volatile RSCT_REG*)(REG_BASE + OFFSET_PDER))->CLEAR = group.mask;
+        }
+
+        // GPER (GPIO Enable Register) : set the pins as driven by the GPIO controller
+        ((volatile RSCT_REG*)(REG_BASE + OFFSET_GPER))->SET = group.mask;
+
+        // Save the current state for polling functions
+        uint32_t state = ((volatile RSCT_REG*)(REG_BASE + OFFSET_PVR))->RW;
+        _portsState[static_cast<uint8_t>(group.port)] = (_portsState[static_cast<uint8_t>(group.port)] & ~group.mask) | (state & group.mask);
+    }
+
+    void enableOutput(const PinGroup& group, uint32_t value) {
+        if (group.port == Port::UNDEFINED) {
+            Error::happened(Error::Module::GPIO, ERR_INVALID_PIN_GROUP, Error::Severity::CRITICAL);
+            return;
+        }
+
+        // Base register offset of this port
+        const uint32_t REG_BASE = GPIO_BASE + static_cast<uint8_t>(group.port) * PORT_REG_SIZE;
+
+        // OVR (Output Value Register) : set the pins output state
+        ((volatile RSCT_REG*)(REG_BASE + OFFSET_OVR))->SET = value & group.mask;
+        ((volatile RSCT_REG*)(REG_BASE + OFFSET_OVR))->CLEAR = ~value & group.mask;
+
+        // ODER (Output Driver Enable Register) : set the pins as output
+        ((volatile RSCT_REG*)(REG_BASE + OFFSET_ODER))->SET = group.mask;
+
+        // GPER (GPIO Enable Register) : set the pins as driven by the GPIO controller
+        ((volatile RSCT_REG*)(REG_BASE + OFFSET_GPER))->SET = group.mask;
+    }
+
     void enablePeripheral(const Pin& pin) {
         if (pin.port == Port::UNDEFINED) {
             return;
@@ -215,22 +274,27 @@ namespace GPIO {
                 + pin.number / 8), INTERRUPT_PRIORITY);
     }
 
-    void enableInterrupt(const Pin& pin, void (*handler)(), Trigger trigger) {
+    void enableInterrupt(const Pin& pin, Callback<> handler, Trigger trigger) {
         if (pin.port == Port::UNDEFINED) {
             return;
         }
 
         // Set the interrupt handler
-        _interruptHandlers[static_cast<uint8_t>(pin.port) * 32 + pin.number] = (uint32_t) handler;
-        Core::setInterruptHandler(static_cast<Core::Interrupt>(
-                static_cast<int>(Core::Interrupt::GPIO0)
-                + static_cast<uint8_t>(pin.port) * 4 
-                + pin.number / 8), &interruptHandlerWrapper);
+        _interruptHandlers[static_cast<uint8_t>(pin.port) * 32 + pin.number] = handler;
+        int channel = static_cast<uint8_t>(pin.port) * 4 + pin.number / 8;
+        Core::setInterruptHandler<interruptHandler, N_PORTS * 4>(static_cast<Core::Interrupt>(
+                static_cast<int>(Core::Interrupt::GPIO0) + channel), channel);
 
         // Enable the interrupt with the function above
         enableInterrupt(pin, trigger);
     }
 
+    // Same as above, but the handler is called with the given context, which allows the same
+    // function to serve several pins (e.g. an encoder or button object)
+    void enableInterrupt(const Pin& pin, void (*handler)(void* context), void* context, Trigger trigger) {
+        enableInterrupt(pin, Callback<>(handler, context), trigger);
+    }
+
     void disableInterrupt(const Pin& pin) {
         if (pin.port == Port::UNDEFINED) {
             return;
@@ -242,7 +306,10 @@ namespace GPIO {
         // Disable the interrupt at the GPIO Controller level
         ((volatile RSCT_REG*)(REG_BASE + OFFSET_IER))->CLEAR = 1 << pin.number;
 
-        // Disable the interrupt at the Core level
+        // Disable the interrupt at the Core level, unless another pin of the same 8-pin group still uses it
+        if (((volatile RSCT_REG*)(REG_BASE + OFFSET_IER))->RW & (0xFF << (pin.number / 8 * 8))) {
+            return;
+        }
         Core::disableInterrupt(static_cast<Core::Interrupt>(
                 static_cast<int>(Core::Interrupt::GPIO0)
                 + static_cast<uint8_t>(pin.port) * 4
@@ -349,29 +416,35 @@ namespace GPIO {
         return result;
     }
 
-    // This wrapper is called when any pin generates an interrupt, and calls
+    // This handler is installed in the vector table for each of the 8-pin channels, and calls
     // the user handler according to the current configuration in _interruptHandlers[]
-    void interruptHandlerWrapper() {
-        // Get the port and pin numbers which called this interrupt
-        int channel = static_cast<int>(Core::currentInterrupt()) - static_cast<int>(Core::Interrupt::GPIO0);
+    void interruptHandler(int channel) {
+        // Get the port which called this interrupt
         int port = channel / 4; // There are four 8-pin channels in each port. The division int truncate is voluntary.
         int subport = channel - 4 * port; // Equivalent to subport = channel % 4
         const uint32_t REG_BASE = GPIO_BASE + port * PORT_REG_SIZE;
 
-        // For each of the 8 pins in this subport, call the handler if the interrupt is enabled (in IER) and pending (in IFR)
-        uint32_t flag = ((volatile RSCT_REG*)(REG_BASE + OFFSET_IFR))->RW & ((volatile RSCT_REG*)(REG_BASE + OFFSET_IER))->RW;
-        for (int pin = 0; pin < 8; pin++) {
-            if (flag & (1 << (subport * 8 + pin))) {
-                // Call the user handler for this interrupt
-                void (*handler)() = (void (*)())_interruptHandlers[port * 32 + subport * 8 + pin];
-                if (handler == nullptr) {
-                    Error::happened(Error::Module::GPIO, ERR_HANDLER_NOT_DEFINED, Error::Severity::CRITICAL);
-                } else {
-                    handler();
-                }
-
-                // Clear the interrupt source
-                ((volatile RSCT_REG*)(REG_BASE + OFFSET_IFR))->CLEAR = 1 << (subport * 8 + pin);
+        // IFR (Interrupt Flag Register) : read the pending interrupts of the 8 pins of this subport once,
+        // and clear them before calling the handlers. Several edges on the same pin which happened before
+        // this point are coalesced into a single call, and an edge happening during its handler will
+        // trigger the interrupt again instead of being lost.
+        uint32_t flags = ((volatile RSCT_REG*)(REG_BASE + OFFSET_IFR))->RW
+                & ((volatile RSCT_REG*)(REG_BASE + OFFSET_IER))->RW
+                & (0xFF << (subport * 8));
+        ((volatile RSCT_REG*)(REG_BASE + OFFSET_IFR))->CLEAR = flags;
+
+        // Walk through the set bits only, lowest pin first
+        const Callback<>* handlers = &_interruptHandlers[port * 32];
+        while (flags) {
+            int pin = __builtin_ctz(flags);
+            flags &= flags - 1;
+
+            // Call the user handler for this interrupt
+            const Callback<>& handler = handlers[pin];
+            if (!handler) {
+                Error::happened(Error::Module::GPIO, ERR_HANDLER_NOT_DEFINED, Error::Severity::CRITICAL);
+            } else {
+                handler();
             }
         }
     }
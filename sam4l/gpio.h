@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include "error.h"
+#include "callback.h"
 
 // General Purpose Input Output
 // This module controls the chip input/output signal pins
@@ -81,88 +82,109 @@ namespace GPIO {
         Periph function;
     };
 
+    // A group of pins on the same port, which can be read and written in a single register access.
+    // Groups are built at compile time from pin constants with the | operator, e.g.
+    // constexpr GPIO::PinGroup lcdData = GPIO::PA08 | GPIO::PA09 | GPIO::PA10 | GPIO::PA11;
+    // The values read and written are port-wide : bit n is the state of pin n of the port.
+    // A group containing pins from different ports is invalid : enableInput() and enableOutput()
+    // report an error and the other functions ignore it. A group declared as constexpr can be
+    // checked at compile time with isValid(), e.g.
+    // static_assert(GPIO::isValid(lcdData), "The LCD data pins must be on the same port");
+    struct PinGroup {
+        Port port;
+        uint32_t mask;
+
+        constexpr PinGroup(const Pin& pin)
+            : port(pin.port), mask((uint32_t)1 << pin.number) {}
+        constexpr PinGroup(const PinGroup& group, const Pin& pin)
+            : port(group.port == pin.port ? group.port : Port::UNDEFINED), mask(group.mask | (uint32_t)1 << pin.number) {}
+    };
+    inline constexpr PinGroup operator|(const Pin& pin1, const Pin& pin2) { return PinGroup(PinGroup(pin1), pin2); }
+    inline constexpr PinGroup operator|(const PinGroup& group, const Pin& pin) { return PinGroup(group, pin); }
+    inline constexpr bool isValid(const PinGroup& group) { return group.port != Port::UNDEFINED; }
+
     // Pin name helpers
-    const Pin PA00 = {Port::A,  0};
-    const Pin PA01 = {Port::A,  1};
-    const Pin PA02 = {Port::A,  2};
-    const Pin PA03 = {Port::A,  3};
-    const Pin PA04 = {Port::A,  4};
-    const Pin PA05 = {Port::A,  5};
-    const Pin PA06 = {Port::A,  6};
-    const Pin PA07 = {Port::A,  7};
-    const Pin PA08 = {Port::A,  8};
-    const Pin PA09 = {Port::A,  9};
-    const Pin PA10 = {Port::A, 10};
-    const Pin PA11 = {Port::A, 11};
-    const Pin PA12 = {Port::A, 12};
-    const Pin PA13 = {Port::A, 13};
-    const Pin PA14 = {Port::A, 14};
-    const Pin PA15 = {Port::A, 15};
-    const Pin PA16 = {Port::A, 16};
-    const Pin PA17 = {Port::A, 17};
-    const Pin PA18 = {Port::A, 18};
-    const Pin PA19 = {Port::A, 19};
-    const Pin PA20 = {Port::A, 20};
-    const Pin PA21 = {Port::A, 21};
-    const Pin PA22 = {Port::A, 22};
-    const Pin PA23 = {Port::A, 23};
-    const Pin PA24 = {Port::A, 24};
-    const Pin PA25 = {Port::A, 25};
-    const Pin PA26 = {Port::A, 26};
-    const Pin PA27 = {Port::A, 27};
-    const Pin PA28 = {Port::A, 28};
-    const Pin PA29 = {Port::A, 29};
-    const Pin PA30 = {Port::A, 30};
-    const Pin PA31 = {Port::A, 31};
-    const Pin PB00 = {Port::B,  0};
-    const Pin PB01 = {Port::B,  1};
-    const Pin PB02 = {Port::B,  2};
-    const Pin PB03 = {Port::B,  3};
-    const Pin PB04 = {Port::B,  4};
-    const Pin PB05 = {Port::B,  5};
-    const Pin PB06 = {Port::B,  6};
-    const Pin PB07 = {Port::B,  7};
-    const Pin PB08 = {Port::B,  8};
-    const Pin PB09 = {Port::B,  9};
-    const Pin PB10 = {Port::B, 10};
-    const Pin PB11 = {Port::B, 11};
-    const Pin PB12 = {Port::B, 12};
-    const Pin PB13 = {Port::B, 13};
-    const Pin PB14 = {Port::B, 14};
-    const Pin PB15 = {Port::B, 15};
-    const Pin PC00 = {Port::C,  0};
-    const Pin PC01 = {Port::C,  1};
-    const Pin PC02 = {Port::C,  2};
-    const Pin PC03 = {Port::C,  3};
-    const Pin PC04 = {Port::C,  4};
-    const Pin PC05 = {Port::C,  5};
-    const Pin PC06 = {Port::C,  6};
-    const Pin PC07 = {Port::C,  7};
-    const Pin PC08 = {Port::C,  8};
-    const Pin PC09 = {Port::C,  9};
-    const Pin PC10 = {Port::C, 10};
-    const Pin PC11 = {Port::C, 11};
-    const Pin PC12 = {Port::C, 12};
-    const Pin PC13 = {Port::C, 13};
-    const Pin PC14 = {Port::C, 14};
-    const Pin PC15 = {Port::C, 15};
-    const Pin PC16 = {Port::C, 16};
-    const Pin PC17 = {Port::C, 17};
-    const Pin PC18 = {Port::C, 18};
-    const Pin PC19 = {Port::C, 19};
-    const Pin PC20 = {Port::C, 20};
-    const Pin PC21 = {Port::C, 21};
-    const Pin PC22 = {Port::C, 22};
-    const Pin PC23 = {Port::C, 23};
-    const Pin PC24 = {Port::C, 24};
-    const Pin PC25 = {Port::C, 25};
-    const Pin PC26 = {Port::C, 26};
-    const Pin PC27 = {Port::C, 27};
-    const Pin PC28 = {Port::C, 28};
-    const Pin PC29 = {Port::C, 29};
-    const Pin PC30 = {Port::C, 30};
-    const Pin PC31 = {Port::C, 31};
-    const Pin UNDEFINED = {Port::UNDEFINED, 0};
+    constexpr Pin PA00 = {Port::A,  0};
+    constexpr Pin PA01 = {Port::A,  1};
+    constexpr Pin PA02 = {Port::A,  2};
+    constexpr Pin PA03 = {Port::A,  3};
+    constexpr Pin PA04 = {Port::A,  4};
+    constexpr Pin PA05 = {Port::A,  5};
+    constexpr Pin PA06 = {Port::A,  6};
+    constexpr Pin PA07 = {Port::A,  7};
+    constexpr Pin PA08 = {Port::A,  8};
+    constexpr Pin PA09 = {Port::A,  9};
+    constexpr Pin PA10 = {Port::A, 10};
+    constexpr Pin PA11 = {Port::A, 11};
+    constexpr Pin PA12 = {Port::A, 12};
+    constexpr Pin PA13 = {Port::A, 13};
+    constexpr Pin PA14 = {Port::A, 14};
+    constexpr Pin PA15 = {Port::A, 15};
+    constexpr Pin PA16 = {Port::A, 16};
+    constexpr Pin PA17 = {Port::A, 17};
+    constexpr Pin PA18 = {Port::A, 18};
+    constexpr Pin PA19 = {Port::A, 19};
+    constexpr Pin PA20 = {Port::A, 20};
+    constexpr Pin PA21 = {Port::A, 21};
+    constexpr Pin PA22 = {Port::A, 22};
+    constexpr Pin PA23 = {Port::A, 23};
+    constexpr Pin PA24 = {Port::A, 24};
+    constexpr Pin PA25 = {Port::A, 25};
+    constexpr Pin PA26 = {Port::A, 26};
+    constexpr Pin PA27 = {Port::A, 27};
+    constexpr Pin PA28 = {Port::A, 28};
+    constexpr Pin PA29 = {Port::A, 29};
+    constexpr Pin PA30 = {Port::A, 30};
+    constexpr Pin PA31 = {Port::A, 31};
+    constexpr Pin PB00 = {Port::B,  0};
+    constexpr Pin PB01 = {Port::B,  1};
+    constexpr Pin PB02 = {Port::B,  2};
+    constexpr Pin PB03 = {Port::B,  3};
+    constexpr Pin PB04 = {Port::B,  4};
+    constexpr Pin PB05 = {Port::B,  5};
+    constexpr Pin PB06 = {Port::B,  6};
+    constexpr Pin PB07 = {Port::B,  7};
+    constexpr Pin PB08 = {Port::B,  8};
+    constexpr Pin PB09 = {Port::B,  9};
+    constexpr Pin PB10 = {Port::B, 10};
+    constexpr Pin PB11 = {Port::B, 11};
+    constexpr Pin PB12 = {Port::B, 12};
+    constexpr Pin PB13 = {Port::B, 13};
+    constexpr Pin PB14 = {Port::B, 14};
+    constexpr Pin PB15 = {Port::B, 15};
+    constexpr Pin PC00 = {Port::C,  0};
+    constexpr Pin PC01 = {Port::C,  1};
+    constexpr Pin PC02 = {Port::C,  2};
+    constexpr Pin PC03 = {Port::C,  3};
+    constexpr Pin PC04 = {Port::C,  4};
+    constexpr Pin PC05 = {Port::C,  5};
+    constexpr Pin PC06 = {Port::C,  6};
+    constexpr Pin PC07 = {Port::C,  7};
+    constexpr Pin PC08 = {Port::C,  8};
+    constexpr Pin PC09 = {Port::C,  9};
+    constexpr Pin PC10 = {Port::C, 10};
+    constexpr Pin PC11 = {Port::C, 11};
+    constexpr Pin PC12 = {Port::C, 12};
+    constexpr Pin PC13 = {Port::C, 13};
+    constexpr Pin PC14 = {Port::C, 14};
+    constexpr Pin PC15 = {Port::C, 15};
+    constexpr Pin PC16 = {Port::C, 16};
+    constexpr Pin PC17 = {Port::C, 17};
+    constexpr Pin PC18 = {Port::C, 18};
+    constexpr Pin PC19 = {Port::C, 19};
+    constexpr Pin PC20 = {Port::C, 20};
+    constexpr Pin PC21 = {Port::C, 21};
+    constexpr Pin PC22 = {Port::C, 22};
+    constexpr Pin PC23 = {Port::C, 23};
+    constexpr Pin PC24 = {Port::C, 24};
+    constexpr Pin PC25 = {Port::C, 25};
+    constexpr Pin PC26 = {Port::C, 26};
+    constexpr Pin PC27 = {Port::C, 27};
+    constexpr Pin PC28 = {Port::C, 28};
+    constexpr Pin PC29 = {Port::C, 29};
+    constexpr Pin PC30 = {Port::C, 30};
+    constexpr Pin PC31 = {Port::C, 31};
+    constexpr Pin UNDEFINED = {Port::UNDEFINED, 0};
 
     // The PinState type can be used for clearer types, even though it's basically a boolean
     using PinState = bool;
@@ -178,6 +200,7 @@ namespace GPIO {
     // Error codes
     const Error::Code ERR_PIN_ALREADY_IN_USE = 1;
     const Error::Code ERR_HANDLER_NOT_DEFINED = 2;
+    const Error::Code ERR_INVALID_PIN_GROUP = 3;
 
 
     // Module API
@@ -196,8 +219,9 @@ namespace GPIO {
     void disablePeripheral(const Pin& pin);
 
     // Interrupts
-    void enableInterrupt(const Pin& pin, void (*handler)(), Trigger trigger=Trigger::RISING);
+    void enableInterrupt(const Pin& pin, Callback<> handler, Trigger trigger=Trigger::RISING);
     void enableInterrupt(const Pin& pin, Trigger trigger=Trigger::RISING);
+    void enableInterrupt(const Pin& pin, void (*handler)(void* context), void* context, Trigger trigger=Trigger::RISING);
     void disableInterrupt(const Pin& pin);
 
     // Helper functions
@@ -213,6 +237,81 @@ namespace GPIO {
     bool fallingEdge(const Pin& pin);
     bool changed(const Pin& pin);
 
+    // Pin groups
+    // The pins of a group are changed by writing their mask in the SET, CLEAR or TOGGLE register
+    // of the port, which never affects the other pins of the port, even if an interrupt changes them
+    // at the same time. setHigh(), setLow() and toggle() change all the pins simultaneously with a
+    // single write ; set() needs two writes (SET then CLEAR), so the pins set to 1 change just
+    // before the pins set to 0
+    void enableInput(const PinGroup& group, Pulling pulling=Pulling::NONE);
+    void enableOutput(const PinGroup& group, uint32_t value=0);
+    inline uint32_t get(const PinGroup& group) {
+        if (group.port == Port::UNDEFINED) {
+            return 0;
+        }
+        return ((volatile RSCT_REG*)(GPIO_BASE + static_cast<uint8_t>(group.port) * PORT_REG_SIZE + OFFSET_PVR))->RW & group.mask;
+    }
+    inline void set(const PinGroup& group, uint32_t value) {
+        if (group.port == Port::UNDEFINED) {
+            return;
+        }
+        // No read-modify-write : a pin changed by an interrupt between the two writes is not affected
+        volatile RSCT_REG* ovr = (volatile RSCT_REG*)(GPIO_BASE + static_cast<uint8_t>(group.port) * PORT_REG_SIZE + OFFSET_OVR);
+        ovr->SET = value & group.mask;
+        ovr->CLEAR = ~value & group.mask;
+    }
+    inline void setHigh(const PinGroup& group) {
+        if (group.port == Port::UNDEFINED) {
+            return;
+        }
+        ((volatile RSCT_REG*)(GPIO_BASE + static_cast<uint8_t>(group.port) * PORT_REG_SIZE + OFFSET_OVR))->SET = group.mask;
+    }
+    inline void setLow(const PinGroup& group) {
+        if (group.port == Port::UNDEFINED) {
+            return;
+        }
+        ((volatile RSCT_REG*)(GPIO_BASE + static_cast<uint8_t>(group.port) * PORT_REG_SIZE + OFFSET_OVR))->CLEAR = group.mask;
+    }
+    inline void toggle(const PinGroup& group) {
+        if (group.port == Port::UNDEFINED) {
+            return;
+        }
+        ((volatile RSCT_REG*)(GPIO_BASE + static_cast<uint8_t>(group.port) * PORT_REG_SIZE + OFFSET_OVR))->TOGGLE = group.mask;
+    }
+
+    // Compile-time pins
+    // A pin known at compile time can be declared as a type, e.g.
+    // using PinLed = GPIO::StaticPin<GPIO::Port::A, 0>;
+    // Its functions are inlined with the register address and mask as constants, so that
+    // PinLed::setHigh() compiles to a single store, as setHighPA00() below. The pin is also
+    // checked against the current package at compile time. It can be converted to a Pin
+    // with PinLed::pin() to be used with the functions above or with setPin() of other modules.
+    constexpr bool isAvailable(Port port, uint8_t number) {
+#ifdef PACKAGE
+        return (port == Port::A && number < 32)
+            || (port == Port::B && number < 16 && PACKAGE >= 64)
+            || (port == Port::C && number < 32 && PACKAGE == 100);
+#else
+        return port != Port::UNDEFINED && number < 32;
+#endif
+    }
+
+    template<Port PORT, uint8_t NUMBER, Periph FUNCTION=Periph::A>
+    struct StaticPin {
+        static_assert(isAvailable(PORT, NUMBER), "This pin is not available on this package");
+        static constexpr uint32_t REG_BASE = GPIO_BASE + static_cast<uint8_t>(PORT) * PORT_REG_SIZE;
+        static constexpr uint32_t MASK = (uint32_t)1 << NUMBER;
+
+        static constexpr Pin pin() { return {PORT, NUMBER, FUNCTION}; }
+        static inline void enableInput(Pulling pulling=Pulling::NONE) { GPIO::enableInput(pin(), pulling); }
+        static inline void enableOutput(PinState value=LOW) { GPIO::enableOutput(pin(), value); }
+        static inline PinState get() { return ((volatile RSCT_REG*)(REG_BASE + OFFSET_PVR))->RW & MASK; }
+        static inline void setHigh() { ((volatile RSCT_REG*)(REG_BASE + OFFSET_OVR))->SET = MASK; }
+        static inline void setLow() { ((volatile RSCT_REG*)(REG_BASE + OFFSET_OVR))->CLEAR = MASK; }
+        static inline void toggle() { ((volatile RSCT_REG*)(REG_BASE + OFFSET_OVR))->TOGGLE = MASK; }
+        static inline void set(PinState value) { if (value) { setHigh(); } else { setLow(); } }
+    };
+
     // PA00 and PB00 can be turned on and off quickly with these functions.
     // This is useful for debug purposes, when you want to switch a pin when something
     // has happened but you want to use as few clock cycles as possible
@@ -20,6 +20,18 @@ namespace I2C {
         int txDMAChannel = -1;
         unsigned int nBytesToRead = 0;
         unsigned int nBytesToWrite = 0;
+        unsigned int frequency = 0;
+        unsigned int busCapacitance = 0;
+        unsigned int pullUp = 0;
+        unsigned int frequencyBeforeHS = 0;
+        uint32_t cmdrHS = 0;
+        volatile bool asyncTransferRunning = false;
+        Callback<Port, bool> asyncTransferHandler;
+        uint8_t* registerFile = nullptr;
+        int registerFileSize = 0;
+        int registerPointer = 0;
+        volatile bool registerFileDiscard = false;
+        Callback<Port, int, int> registerFileHandler;
     };
 
     // List of available ports
@@ -27,10 +39,14 @@ namespace I2C {
 
     // Interrupt handlers
     extern uint8_t INTERRUPT_PRIORITY;
-    uint32_t _interruptHandlers[N_PORTS_M][N_INTERRUPTS];
+    Callback<> _interruptHandlers[N_PORTS_M][N_INTERRUPTS];
     Core::Interrupt _interruptChannelsMaster[] = {Core::Interrupt::TWIM0, Core::Interrupt::TWIM1, Core::Interrupt::TWIM2, Core::Interrupt::TWIM3};
     Core::Interrupt _interruptChannelsSlave[] = {Core::Interrupt::TWIS0, Core::Interrupt::TWIS1};
-    void interruptHandlerWrapper();
+    void slaveInterruptHandler(int n);
+    void masterInterruptHandler(int n);
+    void registerFileInterruptHandler(Port port);
+    void registerFileRXFinishedHandler(void* context);
+    void disableRegisterFile(Port port);
 
     // Clocks
     const int PM_CLK_M[] = {PM::CLK_I2CM0, PM::CLK_I2CM1, PM::CLK_I2CM2, PM::CLK_I2CM3}; // Master mode
@@ -43,8 +59,29 @@ namespace I2C {
     // Registers base address
     const uint32_t I2C_BASE[] = {0x40018000, 0x4001C000, 0x40078000, 0x4007C000};
 
-    // I2C clock frequency
-    unsigned int _frequency = 0;
+    // Timing constraints for each speed mode, in ns (see the I2C-bus specification UM10204, table 10)
+    struct TimingLimits {
+        unsigned int minLow;       // tLOW
+        unsigned int minHigh;      // tHIGH
+        unsigned int minStaSto;    // max(tHD;STA, tSU;STA, tSU;STO, tBUF)
+        unsigned int maxRise;      // tr
+    };
+    const TimingLimits TIMING_LIMITS[] = {
+        {4700, 4000, 4700, 1000},  // Standard-mode (100kHz)
+        {1300, 600, 1300, 300},    // Fast-mode (400kHz)
+        {500, 260, 500, 120},      // Fast-mode Plus (1MHz)
+        {160, 60, 160, 40},        // High-speed mode (3.4MHz, Cb <= 100pF)
+        {320, 120, 160, 80},       // High-speed mode (1.7MHz, Cb <= 400pF)
+    };
+    const int TIMING_STANDARD = 0;
+    const int TIMING_FAST = 1;
+    const int TIMING_FAST_PLUS = 2;
+    const int TIMING_HS_100PF = 3;
+    const int TIMING_HS_400PF = 4;
+
+    uint32_t computeCWGR(unsigned long fClk, unsigned int frequency, const TimingLimits& limits, unsigned int riseTime, unsigned int* actualFrequency);
+    unsigned int estimateRiseTime(unsigned int busCapacitance, unsigned int pullUp);
+    bool checkArbitrationLost(Port port);
 
 
 
@@ -71,7 +108,7 @@ namespace I2C {
 
         // Initialize interrupt handlers
         for (int i = 0; i < N_INTERRUPTS; i++) {
-            _interruptHandlers[static_cast<int>(port)][i] = (uint32_t)nullptr;
+            _interruptHandlers[static_cast<int>(port)][i] = nullptr;
         }
 
         // Enable the clock
@@ -85,36 +122,287 @@ namespace I2C {
         (*(volatile uint32_t*)(REG_BASE + OFFSET_M_CR))
             = 1 << M_CR_SWRST;        // SWRST : software reset
 
+        // CWGR (Clock Waveform Generator Register) and SRR (Slew Rate Register) : setup the SCL (clock) line
+        p->cmdrHS = 0;
+        setTiming(port, frequency);
+
+        // Set up the DMA channels and related interrupts
+        p->rxDMAChannel = DMA::setupChannel(p->rxDMAChannel, static_cast<DMA::Device>(static_cast<int>(DMA::Device::I2C0_M_RX) + static_cast<int>(port)), DMA::Size::BYTE);
+        p->txDMAChannel = DMA::setupChannel(p->txDMAChannel, static_cast<DMA::Device>(static_cast<int>(DMA::Device::I2C0_M_TX) + static_cast<int>(port)), DMA::Size::BYTE);
+
+        // Set the pins in peripheral mode
+        GPIO::enablePeripheral(PINS_SDA[static_cast<int>(port)]);
+        GPIO::enablePeripheral(PINS_SCL[static_cast<int>(port)]);
+
+        return true;
+    }
+
+    // Estimate the rise time (in ns) of the lines from the bus capacitance (in pF) and the value of the
+    // pull-up resistors (in ohms) : tr = 0.8473 * Rp * Cb (from 0.3*VDD to 0.7*VDD)
+    unsigned int estimateRiseTime(unsigned int busCapacitance, unsigned int pullUp) {
+        return ((uint64_t)pullUp * busCapacitance * 8473) / 10000000;
+    }
+
+    // Internal function which computes the CWGR (or HSCWGR) value for the given frequency and timing limits.
+    // The TWIM starts counting the HIGH period only once it sees the SCL line high, so the rise time is
+    // removed from the period budget. The remaining budget is shared between the LOW and HIGH periods
+    // proportionally to their minimums, and the smallest prescaler which fits the counters is selected.
+    uint32_t computeCWGR(unsigned long fClk, unsigned int frequency, const TimingLimits& limits, unsigned int riseTime, unsigned int* actualFrequency) {
+        // Period budget, in ns
+        unsigned int period = 1000000000UL / frequency;
+        unsigned int tLow = limits.minLow;
+        unsigned int tHigh = limits.minHigh;
+        if (period > riseTime + limits.minLow + limits.minHigh) {
+            unsigned int extra = period - riseTime - limits.minLow - limits.minHigh;
+            tLow += (uint64_t)extra * limits.minLow / (limits.minLow + limits.minHigh);
+            tHigh = period - riseTime - tLow;
+        } else {
+            Error::happened(Error::Module::I2C, WARN_FREQUENCY_NOT_ACHIEVABLE, Error::Severity::WARNING);
+        }
+
+        // Find the smallest prescaler for which every counter fits in its field
+        for (int exp = 0; exp <= 7; exp++) {
+            unsigned long fPrescaler = fClk >> (exp + 1);
+            uint32_t low = ((uint64_t)tLow * fPrescaler + 999999999UL) / 1000000000UL;
+            uint32_t high = ((uint64_t)tHigh * fPrescaler + 999999999UL) / 1000000000UL;
+            uint32_t stasto = ((uint64_t)limits.minStaSto * fPrescaler + 999999999UL) / 1000000000UL;
+            uint32_t data = low / 4;
+            if (low > 0xFF || high > 0xFF || stasto > 0xFF) {
+                continue;
+            }
+            if (low == 0) {
+                low = 1;
+            }
+            if (high == 0) {
+                high = 1;
+            }
+            if (stasto == 0) {
+                stasto = 1;
+            }
+            if (data == 0) {
+                data = 1;
+            } else if (data > 0xF) {
+                data = 0xF;
+            }
+
+            if (actualFrequency != nullptr) {
+                *actualFrequency = 1000000000UL / ((uint64_t)(low + high) * 1000000000UL / fPrescaler + riseTime);
+            }
+            return low << M_CWGR_LOW
+                 | high << M_CWGR_HIGH
+                 | stasto << M_CWGR_STASTO
+                 | data << M_CWGR_DATA
+                 | exp << M_CWGR_EXP;
+        }
+
+        // The requested frequency is too low for this clock
+        Error::happened(Error::Module::I2C, WARN_FREQUENCY_NOT_ACHIEVABLE, Error::Severity::WARNING);
+        if (actualFrequency != nullptr) {
+            *actualFrequency = 0;
+        }
+        return 0xFF << M_CWGR_LOW | 0xFF << M_CWGR_HIGH | 0xFF << M_CWGR_STASTO | 0xF << M_CWGR_DATA | 7 << M_CWGR_EXP;
+    }
+
+    // Configure the SCL timings of a master port in Standard-mode (up to 100kHz), Fast-mode (up to 400kHz)
+    // or Fast-mode Plus (up to 1MHz), according to the electrical characteristics of the bus. If riseTime (in ns)
+    // is 0, it is estimated from the bus capacitance (in pF) and the pull-up resistors (in ohms).
+    // Return the actual frequency of the bus.
+    unsigned int setTiming(Port port, unsigned int frequency, unsigned int busCapacitance, unsigned int pullUp, unsigned int riseTime) {
+        struct Channel* p = &(_ports[static_cast<int>(port)]);
+        if (p->mode != Mode::MASTER) {
+            Error::happened(Error::Module::I2C, ERR_PORT_NOT_INITIALIZED, Error::Severity::CRITICAL);
+            return 0;
+        }
+        const uint32_t REG_BASE = I2C_BASE[static_cast<int>(port)];
+        if (frequency == 0) {
+            return 0;
+        }
+        if (frequency > FREQUENCY_FAST_PLUS) {
+            Error::happened(Error::Module::I2C, WARN_FREQUENCY_NOT_ACHIEVABLE, Error::Severity::WARNING);
+            frequency = FREQUENCY_FAST_PLUS;
+        }
+
+        // Select the timing constraints of the corresponding speed mode
+        int mode = TIMING_STANDARD;
+        if (frequency > FREQUENCY_FAST) {
+            mode = TIMING_FAST_PLUS;
+        } else if (frequency > FREQUENCY_STANDARD) {
+            mode = TIMING_FAST;
+        }
+        const TimingLimits& limits = TIMING_LIMITS[mode];
+
+        // Save the bus parameters for autoTune()
+        p->frequency = frequency;
+        p->busCapacitance = busCapacitance;
+        p->pullUp = pullUp;
+        if (riseTime == 0) {
+            riseTime = estimateRiseTime(busCapacitance, pullUp);
+        }
+        if (riseTime > limits.maxRise) {
+            // The bus is out of specifications for this mode (pull-ups too weak or too much
+            // capacitance), the timings are still computed but the frequency will be lower
+            Error::happened(Error::Module::I2C, WARN_FREQUENCY_NOT_ACHIEVABLE, Error::Severity::WARNING);
+        }
+
         // CWGR (Clock Waveform Generator Register) : setup the SCL (clock) line
-        _frequency = frequency;
-        unsigned long fPrescaler = PM::getModuleClockFrequency(PM_CLK_M[static_cast<int>(port)]) / 2; // Prescaler at EXP=0 divides the freq. by 2
-        unsigned int periods = fPrescaler / frequency;
-        uint8_t t = periods / 2;
+        unsigned int actualFrequency = 0;
         (*(volatile uint32_t*)(REG_BASE + OFFSET_M_CWGR))
-            = t << M_CWGR_LOW      // LOW : low and buffer counter
-            | t << M_CWGR_HIGH     // HIGH : high counter
-            | t << M_CWGR_STASTO   // STASTO : start/stop counters
-            | 1 << M_CWGR_DATA     // DATA : data time counter
-            | 0 << M_CWGR_EXP;     // EXP : clock prescaler
+            = computeCWGR(PM::getModuleClockFrequency(PM_CLK_M[static_cast<int>(port)]), frequency, limits, riseTime, &actualFrequency);
 
         // SRR (Slew Rate Register) : setup the lines
+        // Fast-mode Plus requires the strongest pull-down drive to discharge the bus in time.
         // See Electrical Characteristics in the datasheet for more details
+        uint32_t drive = (mode == TIMING_FAST_PLUS ? 7 : 3);
         (*(volatile uint32_t*)(REG_BASE + OFFSET_M_SRR))
-            = 3 << M_SRR_DADRIVEL
+            = drive << M_SRR_DADRIVEL
             | 0 << M_SRR_DASLEW
-            | 3 << M_SRR_CLDRIVEL
+            | drive << M_SRR_CLDRIVEL
             | 0 << M_SRR_CLSLEW
             | 2 << M_SRR_FILTER;
 
-        // Set up the DMA channels and related interrupts
-        p->rxDMAChannel = DMA::setupChannel(p->rxDMAChannel, static_cast<DMA::Device>(static_cast<int>(DMA::Device::I2C0_M_RX) + static_cast<int>(port)), DMA::Size::BYTE);
-        p->txDMAChannel = DMA::setupChannel(p->txDMAChannel, static_cast<DMA::Device>(static_cast<int>(DMA::Device::I2C0_M_TX) + static_cast<int>(port)), DMA::Size::BYTE);
+        return actualFrequency;
+    }
 
-        // Set the pins in peripheral mode
-        GPIO::enablePeripheral(PINS_SDA[static_cast<int>(port)]);
-        GPIO::enablePeripheral(PINS_SCL[static_cast<int>(port)]);
+    // Configure a master port in High-speed mode (up to 3.4MHz). Every transfer will begin with the given
+    // master code (0 to 7) sent in Fast-mode, after which the bus switches to the HSCWGR timings until the
+    // next STOP condition. Return the actual frequency of the bus in High-speed mode.
+    unsigned int enableHighSpeed(Port port, unsigned int frequency, uint8_t masterCode, unsigned int busCapacitance, unsigned int pullUp, unsigned int riseTime) {
+        struct Channel* p = &(_ports[static_cast<int>(port)]);
+        if (p->mode != Mode::MASTER) {
+            Error::happened(Error::Module::I2C, ERR_PORT_NOT_INITIALIZED, Error::Severity::CRITICAL);
+            return 0;
+        }
+        const uint32_t REG_BASE = I2C_BASE[static_cast<int>(port)];
 
-        return true;
+        // Remember the current frequency for disableHighSpeed(), unless HS mode is already enabled
+        if (p->cmdrHS == 0) {
+            p->frequencyBeforeHS = p->frequency;
+        }
+
+        // The master code is always sent in Fast-mode
+        setTiming(port, FREQUENCY_FAST, busCapacitance, pullUp);
+
+        // Select the timing constraints according to the bus capacitance
+        const TimingLimits& limits = TIMING_LIMITS[busCapacitance <= 100 ? TIMING_HS_100PF : TIMING_HS_400PF];
+        if (riseTime == 0) {
+            riseTime = estimateRiseTime(busCapacitance, pullUp);
+        }
+        if (frequency > FREQUENCY_HIGH_SPEED) {
+            frequency = FREQUENCY_HIGH_SPEED;
+        }
+
+        // HSCWGR (High-speed Clock Waveform Generator Register) : setup the SCL line in HS mode
+        unsigned int actualFrequency = 0;
+        (*(volatile uint32_t*)(REG_BASE + OFFSET_M_HSCWGR))
+            = computeCWGR(PM::getModuleClockFrequency(PM_CLK_M[static_cast<int>(port)]), frequency, limits, riseTime, &actualFrequency);
+
+        // HSSRR (HS-mode Slew Rate Register) : setup the lines with the strongest drive
+        (*(volatile uint32_t*)(REG_BASE + OFFSET_M_HSSRR))
+            = 7 << M_SRR_DADRIVEL
+            | 0 << M_SRR_DASLEW
+            | 7 << M_SRR_CLDRIVEL
+            | 0 << M_SRR_CLSLEW
+            | 1 << M_SRR_FILTER;
+
+        // Every following command will be executed in HS mode
+        p->cmdrHS = 1 << M_CMDR_HS | (masterCode & 0b111) << M_CMDR_HSMCODE;
+
+        return actualFrequency;
+    }
+
+    // Leave High-speed mode and go back to the Standard/Fast/Fast-mode Plus timings which were used
+    // before enableHighSpeed(), or to the given frequency if it is not 0
+    void disableHighSpeed(Port port, unsigned int frequency) {
+        struct Channel* p = &(_ports[static_cast<int>(port)]);
+        if (frequency == 0) {
+            if (p->cmdrHS == 0) {
+                return;
+            }
+            frequency = p->frequencyBeforeHS;
+        }
+        p->cmdrHS = 0;
+        setTiming(port, frequency, p->busCapacitance, p->pullUp);
+    }
+
+    // Measure the effective bit rate of the bus by timing a read from the given device, and adjust
+    // the timings so that the effective frequency gets as close as possible to the one requested in
+    // setTiming(). The measured overhead includes the actual rise time of the bus and the clock stretching
+    // applied by the slave, which are then removed from the SCL period budget (within the limits of the
+    // speed mode). Return the effective frequency measured before tuning, or 0 if the device did not answer.
+    unsigned int autoTune(Port port, uint8_t address, int nBytes) {
+        struct Channel* p = &(_ports[static_cast<int>(port)]);
+        if (p->mode != Mode::MASTER) {
+            Error::happened(Error::Module::I2C, ERR_PORT_NOT_INITIALIZED, Error::Severity::CRITICAL);
+            return 0;
+        }
+        const uint32_t REG_BASE = I2C_BASE[static_cast<int>(port)];
+        if (p->cmdrHS != 0 || p->asyncTransferRunning || checkArbitrationLost(port)) {
+            return 0;
+        }
+        if (nBytes > BUFFER_SIZE) {
+            nBytes = BUFFER_SIZE;
+        }
+
+        // CR (Control Register) : reset the interface
+        (*(volatile uint32_t*)(REG_BASE + OFFSET_M_CR))
+            = 1 << M_CR_SWRST;
+        (*(volatile uint32_t*)(REG_BASE + OFFSET_M_CR))
+            = 1 << M_CR_MEN;
+        (*(volatile uint32_t*)(REG_BASE + OFFSET_M_SCR)) = 0xFFFFFFFF;
+        DMA::startChannel(p->rxDMAChannel, (uint32_t)(p->buffer), nBytes);
+
+        // CMDR (Command Register) : initiate a read transfer and measure its duration using the SysTick,
+        // without any delay in the polling loop
+        uint32_t t0 = *(volatile uint32_t*) Core::SYST_CVR;
+        (*(volatile uint32_t*)(REG_BASE + OFFSET_M_CMDR))
+            = 1 << M_CMDR_READ
+            | address << M_CMDR_SADR
+            | 1 << M_CMDR_START
+            | 1 << M_CMDR_STOP
+            | 1 << M_CMDR_VALID
+            | nBytes << M_CMDR_NBYTES;
+        uint32_t status = 0;
+        do {
+            status = (*(volatile uint32_t*)(REG_BASE + OFFSET_M_SR));
+        } while (!(status & (1 << M_SR_IDLE | 1 << M_SR_ANAK | 1 << M_SR_DNAK | 1 << M_SR_ARBLST)));
+        uint32_t t1 = *(volatile uint32_t*) Core::SYST_CVR;
+
+        // Cancel the tuning if the slave has not responded
+        if (status & (1 << M_SR_ANAK | 1 << M_SR_DNAK | 1 << M_SR_ARBLST)) {
+            (*(volatile uint32_t*)(REG_BASE + OFFSET_M_CMDR)) = 0;
+            (*(volatile uint32_t*)(REG_BASE + OFFSET_M_SCR)) = 0xFFFFFFFF;
+            DMA::stopChannel(p->rxDMAChannel);
+            return 0;
+        }
+
+        // SysTick is a 24-bit down counter, which may wrap at a shorter reload value when it
+        // is used as the kernel tick
+        uint32_t rvr = *(volatile uint32_t*) Core::SYST_RVR;
+        uint32_t cycles = t0 >= t1 ? t0 - t1 : t0 + (rvr + 1 - t1);
+
+        // Expected duration of the transfer : address + data bytes (9 bits each), plus the START and STOP
+        // conditions which take approximately one STASTO period each
+        uint32_t cwgr = (*(volatile uint32_t*)(REG_BASE + OFFSET_M_CWGR));
+        unsigned long fPrescaler = PM::getModuleClockFrequency(PM_CLK_M[static_cast<int>(port)]) >> (((cwgr >> M_CWGR_EXP) & 0b111) + 1);
+        unsigned int tBit = (uint64_t)(((cwgr >> M_CWGR_LOW) & 0xFF) + ((cwgr >> M_CWGR_HIGH) & 0xFF)) * 1000000000UL / fPrescaler;
+        unsigned int tStaSto = (uint64_t)((cwgr >> M_CWGR_STASTO) & 0xFF) * 1000000000UL / fPrescaler;
+        unsigned int nBits = 9 * (nBytes + 1);
+        uint64_t measured = (uint64_t)cycles * 1000000000UL / PM::getCPUClockFrequency();
+        unsigned int overhead = 0;
+        if (measured > (uint64_t)nBits * tBit + 2 * tStaSto) {
+            overhead = (measured - nBits * tBit - 2 * tStaSto) / nBits;
+        }
+        unsigned int effectiveFrequency = 1000000000UL / (tBit + overhead);
+
+        // Recompute the timings using the measured overhead as the rise time
+        setTiming(port, p->frequency, p->busCapacitance, p->pullUp, overhead > 0 ? overhead : 1);
+
+        return effectiveFrequency;
+    }
+
+    // Return the frequency requested for this port
+    unsigned int getFrequency(Port port) {
+        return _ports[static_cast<int>(port)].frequency;
     }
 
     // Internal function which checks if the controller has lost the bus arbitration
@@ -164,6 +452,7 @@ namespace I2C {
             | 1 << M_CMDR_START
             | 1 << M_CMDR_STOP
             | 1 << M_CMDR_VALID
+            | p->cmdrHS
             | 0 << M_CMDR_NBYTES;
 
         // Wait for the transfer to complete or an Arbitration lost condition to happen
@@ -173,6 +462,7 @@ namespace I2C {
             if (Core::time() > t0 + TIMEOUT) {
                 Error::happened(Error::Module::I2C, ERR_TIMEOUT, Error::Severity::CRITICAL);
             }
+            Core::yield();
             Core::waitMicroseconds(10);
         }
 
@@ -226,6 +516,7 @@ namespace I2C {
             | 1 << M_CMDR_START
             | 1 << M_CMDR_STOP
             | 1 << M_CMDR_VALID
+            | p->cmdrHS
             | n << M_CMDR_NBYTES;
 
         // Wait for the transfer to be finished
@@ -235,6 +526,7 @@ namespace I2C {
             if (Core::time() > t0 + TIMEOUT) {
                 Error::happened(Error::Module::I2C, ERR_TIMEOUT, Error::Severity::CRITICAL);
             }
+            Core::yield();
             Core::waitMicroseconds(10);
         }
 
@@ -313,7 +605,8 @@ namespace I2C {
             | address << M_CMDR_SADR
             | 1 << M_CMDR_START
             | 1 << M_CMDR_STOP
-            | n << M_CMDR_NBYTES;
+            | n << M_CMDR_NBYTES
+            | p->cmdrHS;
         (*(volatile uint32_t*)(REG_BASE + OFFSET_M_CMDR)) = cmdr;
 
         // CMDR (Command Register) : execute the command
@@ -329,6 +622,7 @@ namespace I2C {
                 if (Core::time() > t0 + TIMEOUT) {
                     Error::happened(Error::Module::I2C, ERR_TIMEOUT, Error::Severity::CRITICAL);
                 }
+                Core::yield();
                 Core::waitMicroseconds(10);
             }
 
@@ -338,6 +632,7 @@ namespace I2C {
                 if (Core::time() > t0 + TIMEOUT) {
                     Error::happened(Error::Module::I2C, ERR_TIMEOUT, Error::Severity::CRITICAL);
                 }
+                Core::yield();
                 Core::waitMicroseconds(10);
             }
         }
@@ -408,6 +703,7 @@ namespace I2C {
             | 1 << M_CMDR_START
             | 0 << M_CMDR_STOP
             | 1 << M_CMDR_VALID
+            | p->cmdrHS
             | nTX << M_CMDR_NBYTES;
 
         // NCMDR (Next Command Register) : initiate a read transfer to follow
@@ -417,6 +713,7 @@ namespace I2C {
             | 1 << M_CMDR_START
             | 1 << M_CMDR_STOP
             | 1 << M_CMDR_VALID
+            | p->cmdrHS
             | nRX << M_CMDR_NBYTES;
 
         // Wait for the transfer to be finished
@@ -426,6 +723,7 @@ namespace I2C {
             if (Core::time() > t0 + TIMEOUT) {
                 Error::happened(Error::Module::I2C, ERR_TIMEOUT, Error::Severity::CRITICAL);
             }
+            Core::yield();
             Core::waitMicroseconds(10);
         }
 
@@ -456,6 +754,138 @@ namespace I2C {
         return writeRead(port, address, &byte, 1, rxBuffer, nRX, acked);
     }
 
+    // Start a write/read transfer in background and return immediately. The transfer is
+    // handled by the DMA and the given handler is called from the TWIM interrupt when the
+    // bus is released, with acked set to false if the slave did not answer or the arbitration
+    // was lost. Since each TWIM has its own DMA channels, transfers can run concurrently on
+    // every enabled port. nTX or nRX can be 0 to perform a simple read or write.
+    // The rxBuffer must stay valid until the handler is called.
+    bool writeReadAsync(Port port, uint8_t address, const uint8_t* txBuffer, int nTX, uint8_t* rxBuffer, int nRX, Callback<Port, bool> handler) {
+        struct Channel* p = &(_ports[static_cast<int>(port)]);
+        if (p->mode != Mode::MASTER) {
+            Error::happened(Error::Module::I2C, ERR_PORT_NOT_INITIALIZED, Error::Severity::CRITICAL);
+            return false;
+        }
+        const uint32_t REG_BASE = I2C_BASE[static_cast<int>(port)];
+        if (p->asyncTransferRunning || checkArbitrationLost(port)) {
+            return false;
+        }
+        p->asyncTransferRunning = true;
+        p->asyncTransferHandler = handler;
+
+        // CR (Control Register) : reset the interface in case a failed previous
+        // transfer is still pending
+        (*(volatile uint32_t*)(REG_BASE + OFFSET_M_CR))
+            = 1 << M_CR_SWRST;
+        (*(volatile uint32_t*)(REG_BASE + OFFSET_M_CR))
+            = 1 << M_CR_MEN;
+
+        // Write at most BUFFER_SIZE characters
+        if (nTX > BUFFER_SIZE) {
+            nTX = BUFFER_SIZE;
+        }
+
+        // Copy the user TX buffer into the port buffer
+        for (int i = 0; i < nTX; i++) {
+            p->buffer[i] = txBuffer[i];
+        }
+
+        // Clear every status
+        (*(volatile uint32_t*)(REG_BASE + OFFSET_M_SCR)) = 0xFFFFFFFF;
+
+        // Copy the first byte to transmit and start the DMA TX channel for the rest
+        if (nTX >= 1) {
+            (*(volatile uint32_t*)(REG_BASE + OFFSET_M_THR)) = p->buffer[0];
+        }
+        if (nTX >= 2) {
+            DMA::startChannel(p->txDMAChannel, (uint32_t)(p->buffer + 1), nTX - 1);
+        }
+
+        // Start the DMA RX channel
+        if (nRX >= 1) {
+            DMA::startChannel(p->rxDMAChannel, (uint32_t)(rxBuffer), nRX);
+        }
+
+        if (nTX >= 1) {
+            // CMDR (Command Register) : initiate a write transfer, followed by a STOP only
+            // if there is nothing to read
+            (*(volatile uint32_t*)(REG_BASE + OFFSET_M_CMDR))
+                = 0 << M_CMDR_READ
+                | address << M_CMDR_SADR
+                | 1 << M_CMDR_START
+                | (nRX == 0) << M_CMDR_STOP
+                | 1 << M_CMDR_VALID
+                | p->cmdrHS
+                | nTX << M_CMDR_NBYTES;
+        }
+
+        if (nRX >= 1) {
+            // CMDR/NCMDR (Next Command Register) : initiate a read transfer, with a repeated
+            // start if it follows a write
+            (*(volatile uint32_t*)(REG_BASE + (nTX >= 1 ? OFFSET_M_NCMDR : OFFSET_M_CMDR)))
+                = 1 << M_CMDR_READ
+                | address << M_CMDR_SADR
+                | 1 << M_CMDR_START
+                | 1 << M_CMDR_STOP
+                | 1 << M_CMDR_VALID
+                | p->cmdrHS
+                | nRX << M_CMDR_NBYTES;
+        }
+
+        // IER (Interrupt Enable Register) : the transfer is over when the interface goes back to idle
+        // or when an error condition is detected
+        (*(volatile uint32_t*)(REG_BASE + OFFSET_M_IER))
+            = 1 << M_SR_IDLE
+            | 1 << M_SR_ANAK
+            | 1 << M_SR_DNAK
+            | 1 << M_SR_ARBLST;
+
+        // Enable the interrupt in the NVIC
+        Core::Interrupt interruptChannel = _interruptChannelsMaster[static_cast<int>(port)];
+        Core::setInterruptHandler<masterInterruptHandler, N_PORTS_M>(interruptChannel, static_cast<int>(port));
+        Core::enableInterrupt(interruptChannel, INTERRUPT_PRIORITY);
+
+        return true;
+    }
+
+    // Return true if no asynchronous transfer is running on this port
+    bool isAsyncTransferFinished(Port port) {
+        return !_ports[static_cast<int>(port)].asyncTransferRunning;
+    }
+
+    // Master interrupt handler of each port, installed directly in the vector table
+    void masterInterruptHandler(int n) {
+        Port port = static_cast<Port>(n);
+        struct Channel* p = &(_ports[n]);
+        const uint32_t REG_BASE = I2C_BASE[n];
+
+        // IDR (Interrupt Disable Register) : the transfer is over, disable the interrupts
+        (*(volatile uint32_t*)(REG_BASE + OFFSET_M_IDR)) = 0xFFFFFFFF;
+
+        // If the slave has not responded or the arbitration was lost, cancel the transfer
+        uint32_t sr = (*(volatile uint32_t*)(REG_BASE + OFFSET_M_SR));
+        bool acked = !(sr & (1 << M_SR_ANAK | 1 << M_SR_DNAK | 1 << M_SR_ARBLST));
+        if (!acked) {
+            (*(volatile uint32_t*)(REG_BASE + OFFSET_M_CMDR)) = 0;
+            (*(volatile uint32_t*)(REG_BASE + OFFSET_M_NCMDR)) = 0;
+            DMA::stopChannel(p->rxDMAChannel);
+            DMA::stopChannel(p->txDMAChannel);
+            if (sr & (1 << M_SR_ARBLST)) {
+                Error::happened(Error::Module::I2C, WARN_ARBITRATION_LOST, Error::Severity::WARNING);
+            }
+        }
+
+        // SCR (Status Clear Register) : clear the flags
+        (*(volatile uint32_t*)(REG_BASE + OFFSET_M_SCR)) = 0xFFFFFFFF;
+
+        // Call the user handler
+        p->asyncTransferRunning = false;
+        const Callback<Port, bool>& handler = p->asyncTransferHandler;
+        if (handler) {
+            handler(port, acked);
+        }
+    }
+
 
 
 
@@ -479,6 +909,7 @@ namespace I2C {
                 | 1 << M_CR_STOP;
         }
         p->mode = Mode::SLAVE;
+        disableRegisterFile(port);
 
         // Initialize the buffer
         for (int i = 0; i < BUFFER_SIZE; i++) {
@@ -487,7 +918,7 @@ namespace I2C {
 
         // Initialize interrupt handlers
         for (int i = 0; i < N_INTERRUPTS; i++) {
-            _interruptHandlers[static_cast<int>(port)][i] = (uint32_t)nullptr;
+            _interruptHandlers[static_cast<int>(port)][i] = nullptr;
         }
 
         // Enable the clock
@@ -536,7 +967,7 @@ namespace I2C {
 
         // Enable the interrupt in the NVIC
         Core::Interrupt interruptChannel = _interruptChannelsSlave[static_cast<int>(port)];
-        Core::setInterruptHandler(interruptChannel, interruptHandlerWrapper);
+        Core::setInterruptHandler<slaveInterruptHandler, N_PORTS_S>(interruptChannel, static_cast<int>(port));
         Core::enableInterrupt(interruptChannel, INTERRUPT_PRIORITY);
 
         // Initialize the slave with an empty write
@@ -585,6 +1016,7 @@ namespace I2C {
                 if (Core::time() > t0 + TIMEOUT) {
                     Error::happened(Error::Module::I2C, ERR_TIMEOUT, Error::Severity::CRITICAL);
                 }
+                Core::yield();
                 Core::waitMicroseconds(10);
             }
 
@@ -661,6 +1093,7 @@ namespace I2C {
                 if (Core::time() > t0 + TIMEOUT) {
                     Error::happened(Error::Module::I2C, ERR_TIMEOUT, Error::Severity::CRITICAL);
                 }
+                Core::yield();
                 Core::waitMicroseconds(10);
             }
 
@@ -725,7 +1158,7 @@ namespace I2C {
         return 0;
     }
 
-    void enableInterrupt(Port port, void (*handler)(), Interrupt interrupt) {
+    void enableInterrupt(Port port, Callback<> handler, Interrupt interrupt) {
         struct Channel* p = &(_ports[static_cast<int>(port)]);
         if (p->mode != Mode::SLAVE) {
             Error::happened(Error::Module::I2C, ERR_PORT_NOT_INITIALIZED, Error::Severity::CRITICAL);
@@ -733,20 +1166,193 @@ namespace I2C {
         }
 
         // Save the user handler
-        _interruptHandlers[static_cast<int>(port)][static_cast<int>(interrupt)] = (uint32_t)handler;
+        _interruptHandlers[static_cast<int>(port)][static_cast<int>(interrupt)] = handler;
     }
 
-    void interruptHandlerWrapper() {
-        // Get the port through the current interrupt number
-        Port port;
-        Core::Interrupt currentInterrupt = Core::currentInterrupt();
-        if (currentInterrupt == Core::Interrupt::TWIS0) {
-            port = Port::I2C0;
-        } else if (currentInterrupt == Core::Interrupt::TWIS1) {
-            port = Port::I2C1;
-        } else {
+    // Enable the slave mode and expose the given buffer as a register file, similar to most I2C sensors.
+    // The first byte written by the master sets the register pointer, the following bytes are written
+    // into the registers by the DMA, starting at this pointer. Read transfers are served by the DMA from
+    // the current pointer. The pointer is incremented automatically after each transfer. The handler is
+    // called after each write transfer with the range of registers (first to last, included) that have
+    // been written by the master, so that the application is never involved in the transfers themselves.
+    // A pointer beyond the end of the file is clamped to size. The bytes written by the master past the
+    // end of the file are acknowledged and discarded by the interrupt handler, so that the clock
+    // stretching never blocks the bus ; reads past the end return dummy bytes.
+    bool enableSlaveRegisterFile(Port port, uint8_t address, uint8_t* registers, int size, Callback<Port, int, int> handler) {
+        if (registers == nullptr || size <= 0 || !enableSlave(port, address)) {
+            return false;
+        }
+        const uint32_t REG_BASE = I2C_BASE[static_cast<int>(port)];
+        struct Channel* p = &(_ports[static_cast<int>(port)]);
+
+        // Save the register file
+        p->registerFile = registers;
+        p->registerFileSize = size;
+        p->registerPointer = 0;
+        p->registerFileDiscard = false;
+        p->registerFileHandler = handler;
+        p->nBytesToRead = 0;
+        p->nBytesToWrite = 0;
+
+        // CR (Control Register) : enable clock stretching, to give the interrupt handler the time
+        // to set up the DMA after the address and register pointer are received
+        (*(volatile uint32_t*)(REG_BASE + OFFSET_S_CR)) |= 1 << S_CR_STREN;
+
+        // IER (Interrupt Enable Register) : enable the Slave Address Match interrupt in addition to
+        // the interrupts enabled by enableSlave()
+        (*(volatile uint32_t*)(REG_BASE + OFFSET_S_IER))
+                = 1 << S_SR_SAM;
+
+        return true;
+    }
+
+    // Change the register pointer, as if the master had written it
+    void setRegisterPointer(Port port, int pointer) {
+        struct Channel* p = &(_ports[static_cast<int>(port)]);
+        if (p->mode != Mode::SLAVE || p->registerFile == nullptr) {
+            Error::happened(Error::Module::I2C, ERR_PORT_NOT_INITIALIZED, Error::Severity::CRITICAL);
             return;
         }
+        p->registerPointer = pointer < p->registerFileSize ? pointer : p->registerFileSize;
+    }
+
+    // Internal interrupt handler for ports in register file mode
+    void registerFileInterruptHandler(Port port) {
+        const uint32_t REG_BASE = I2C_BASE[static_cast<int>(port)];
+        struct Channel* p = &(_ports[static_cast<int>(port)]);
+        uint32_t sr = (*(volatile uint32_t*)(REG_BASE + OFFSET_S_SR));
+
+        // TCOMP : Transfer Complete (STOP or Repeated START), processed first because it may
+        // be pending at the same time as the address match of the next transfer
+        if (sr & (1 << S_SR_TCOMP)) {
+            if (p->nBytesToRead > 0) {
+                // Write transfer : notify the user of the registers which have been written
+                int n = p->nBytesToRead - DMA::getCounter(p->rxDMAChannel);
+                DMA::disableInterrupt(p->rxDMAChannel, DMA::Interrupt::TRANSFER_FINISHED);
+                DMA::stopChannel(p->rxDMAChannel);
+                p->nBytesToRead = 0;
+                if (n > 0) {
+                    int first = p->registerPointer;
+                    p->registerPointer += n;
+                    const Callback<Port, int, int>& handler = p->registerFileHandler;
+                    if (handler) {
+                        handler(port, first, first + n - 1);
+                    }
+                }
+
+            } else if (p->nBytesToWrite > 0) {
+                // Read transfer : NBYTES counts the bytes that were actually sent on the bus, which may
+                // be less than the bytes fetched by the DMA
+                int n = (*(volatile uint32_t*)(REG_BASE + OFFSET_S_NBYTES)) & 0xFF;
+                DMA::stopChannel(p->txDMAChannel);
+                p->nBytesToWrite = 0;
+                p->registerPointer += n;
+            }
+            if (p->registerPointer > p->registerFileSize) {
+                p->registerPointer = p->registerFileSize;
+            }
+
+            // IDR (Interrupt Disable Register) : stop discarding the bytes received past the end of the file
+            p->registerFileDiscard = false;
+            (*(volatile uint32_t*)(REG_BASE + OFFSET_S_IDR))
+                = 1 << S_SR_RXRDY;
+
+            // NBYTES : reset the bytes counter
+            (*(volatile uint32_t*)(REG_BASE + OFFSET_S_NBYTES)) = 0;
+
+            // SCR (Status Clear Register) : clear the interrupt
+            (*(volatile uint32_t*)(REG_BASE + OFFSET_S_SCR))
+                = 1 << S_SR_TCOMP;
+        }
+
+        // SAM : Slave Address Match
+        if (sr & (1 << S_SR_SAM)) {
+            (*(volatile uint32_t*)(REG_BASE + OFFSET_S_NBYTES)) = 0;
+
+            if (sr & (1 << S_SR_TRA)) {
+                // The master reads : send the registers from the current pointer
+                int n = p->registerFileSize - p->registerPointer;
+                if (n > 0) {
+                    p->nBytesToWrite = n;
+                    DMA::startChannel(p->txDMAChannel, (uint32_t)(p->registerFile + p->registerPointer), n);
+                } else {
+                    (*(volatile uint32_t*)(REG_BASE + OFFSET_S_THR)) = 0xFF;
+                }
+
+            } else {
+                // The master writes : the first byte will be the register pointer
+                p->registerFileDiscard = false;
+                (*(volatile uint32_t*)(REG_BASE + OFFSET_S_IER))
+                    = 1 << S_SR_RXRDY;
+            }
+
+            // SCR (Status Clear Register) : clear the interrupt
+            (*(volatile uint32_t*)(REG_BASE + OFFSET_S_SCR))
+                = 1 << S_SR_SAM;
+        }
+
+        // RXRDY : the register pointer, or a byte past the end of the file, has been received
+        if ((*(volatile uint32_t*)(REG_BASE + OFFSET_S_IMR)) & (1 << S_SR_RXRDY)
+                && (*(volatile uint32_t*)(REG_BASE + OFFSET_S_SR)) & (1 << S_SR_RXRDY)) {
+            // RHR (Receive Holding Register) : the byte must be read, otherwise the clock is stretched forever
+            uint8_t byte = (*(volatile uint32_t*)(REG_BASE + OFFSET_S_RHR)) & 0xFF;
+
+            if (!p->registerFileDiscard) {
+                // Receive the following bytes directly into the register file, from the new pointer
+                p->registerPointer = byte < p->registerFileSize ? byte : p->registerFileSize;
+                int n = p->registerFileSize - p->registerPointer;
+                if (n > 0) {
+                    // IDR (Interrupt Disable Register) : the rest of the transfer is handled by the DMA
+                    (*(volatile uint32_t*)(REG_BASE + OFFSET_S_IDR))
+                        = 1 << S_SR_RXRDY;
+                    p->nBytesToRead = n;
+                    DMA::startChannel(p->rxDMAChannel, (uint32_t)(p->registerFile + p->registerPointer), n);
+
+                    // When the DMA has filled the end of the file, the remaining bytes of the transfer are
+                    // discarded. The Transfer Complete flag stays set while TCR is zero, so the interrupt is
+                    // only enabled now that the transfer is armed, and disabled again by its handler.
+                    DMA::enableInterrupt(p->rxDMAChannel, {registerFileRXFinishedHandler, p}, DMA::Interrupt::TRANSFER_FINISHED);
+                } else {
+                    // The pointer is at the end of the file : keep the interrupt to discard the data
+                    p->registerFileDiscard = true;
+                }
+            }
+        }
+    }
+
+    // Internal handler called by the DMA when the end of the file has been written during a write
+    // transfer : the bytes that the master may still send are discarded by the RXRDY interrupt
+    void registerFileRXFinishedHandler(void* context) {
+        struct Channel* p = (struct Channel*)context;
+        Port port = static_cast<Port>(p - _ports);
+
+        // The flag stays set until the channel is started again : disable the interrupt so that it
+        // does not fire again, TCOMP will stop the channel
+        DMA::disableInterrupt(p->rxDMAChannel, DMA::Interrupt::TRANSFER_FINISHED);
+        if (p->registerFile == nullptr || p->nBytesToRead == 0) {
+            // The transfer has already been completed by TCOMP
+            return;
+        }
+        p->registerFileDiscard = true;
+
+        // IER (Interrupt Enable Register) : enable the RXRDY interrupt
+        (*(volatile uint32_t*)(I2C_BASE[static_cast<int>(port)] + OFFSET_S_IER))
+            = 1 << S_SR_RXRDY;
+    }
+
+    // Internal function which leaves the register file mode
+    void disableRegisterFile(Port port) {
+        struct Channel* p = &(_ports[static_cast<int>(port)]);
+        if (p->registerFile != nullptr && p->rxDMAChannel >= 0) {
+            DMA::disableInterrupt(p->rxDMAChannel, DMA::Interrupt::TRANSFER_FINISHED);
+        }
+        p->registerFile = nullptr;
+        p->registerFileDiscard = false;
+    }
+
+    // Slave interrupt handler of each port, installed directly in the vector table
+    void slaveInterruptHandler(int n) {
+        Port port = static_cast<Port>(n);
         const uint32_t REG_BASE = I2C_BASE[static_cast<int>(port)];
 
         // URUN : underrun
@@ -771,21 +1377,26 @@ namespace I2C {
                 = 1 << S_SR_ORUN;
         }
 
+        // Ports in register file mode have their own handler
+        if (_ports[static_cast<int>(port)].registerFile != nullptr) {
+            registerFileInterruptHandler(port);
+            return;
+        }
+
         // TCOMP : Transfer Complete
         if ((*(volatile uint32_t*)(REG_BASE + OFFSET_S_SR)) & (1 << S_SR_TCOMP)) {
             // Call the user handler corresponding to this interrupt
-            void (*handler)() = nullptr;
             if ((*(volatile uint32_t*)(REG_BASE + OFFSET_S_SR)) & (1 << S_SR_TRA)) {
                 // Write finished
-                handler = (void (*)())_interruptHandlers[static_cast<int>(port)][static_cast<int>(Interrupt::ASYNC_WRITE_FINISHED)];
-                if (handler != nullptr) {
+                const Callback<>& handler = _interruptHandlers[static_cast<int>(port)][static_cast<int>(Interrupt::ASYNC_WRITE_FINISHED)];
+                if (handler) {
                     handler();
                 }
 
             } else {
                 // Read finished
-                handler = (void (*)())_interruptHandlers[static_cast<int>(port)][static_cast<int>(Interrupt::ASYNC_READ_FINISHED)];
-                if (handler != nullptr) {
+                const Callback<>& handler = _interruptHandlers[static_cast<int>(port)][static_cast<int>(Interrupt::ASYNC_READ_FINISHED)];
+                if (handler) {
                     handler();
                 }
             }
@@ -807,18 +1418,22 @@ namespace I2C {
         GPIO::disablePeripheral(PINS_SDA[static_cast<int>(port)]);
         GPIO::disablePeripheral(PINS_SCL[static_cast<int>(port)]);
 
-        // Stop the DMA channels
+        // Release the DMA channels
         if (p->txDMAChannel > -1) {
-            DMA::stopChannel(p->txDMAChannel);
+            DMA::freeChannel(p->txDMAChannel);
+            p->txDMAChannel = -1;
         }
         if (p->rxDMAChannel > -1) {
-            DMA::stopChannel(p->rxDMAChannel);
+            DMA::freeChannel(p->rxDMAChannel);
+            p->rxDMAChannel = -1;
         }
 
         if (p->mode == Mode::MASTER) {
             // Disable the interrupt in the NVIC
             Core::Interrupt interruptChannel = _interruptChannelsMaster[static_cast<int>(port)];
             Core::disableInterrupt(interruptChannel);
+            (*(volatile uint32_t*)(REG_BASE + OFFSET_M_IDR)) = 0xFFFFFFFF;
+            p->asyncTransferRunning = false;
 
             // CR (Control Register) : disable the master interface
             (*(volatile uint32_t*)(REG_BASE + OFFSET_M_CR)) = 0;
@@ -839,6 +1454,7 @@ namespace I2C {
         }
 
         p->mode = Mode::NONE;
+        disableRegisterFile(port);
     }
 
     // Advanced function which returns the raw Status Register.
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include "gpio.h"
 #include "error.h"
+#include "callback.h"
 
 // This module allows the chip to connect to an I2C bus, either in Master or Slave mode.
 // I2C is sometimes called TWI (Two-Wire Interface).
@@ -158,6 +159,16 @@ namespace I2C {
         SCL
     };
 
+    // Bus speed modes
+    const unsigned int FREQUENCY_STANDARD = 100000;
+    const unsigned int FREQUENCY_FAST = 400000;
+    const unsigned int FREQUENCY_FAST_PLUS = 1000000;
+    const unsigned int FREQUENCY_HIGH_SPEED = 3400000;
+
+    // Default bus electrical characteristics, used to estimate the rise time
+    const unsigned int DEFAULT_BUS_CAPACITANCE = 50; // pF
+    const unsigned int DEFAULT_PULLUP = 2200; // ohms
+
     // Timeout for transfer operations
     const int TIMEOUT = 1000; // ms
 
@@ -173,6 +184,7 @@ namespace I2C {
     const Error::Code WARN_ARBITRATION_LOST = 2;
     const Error::Code ERR_PORT_NOT_INITIALIZED = 3;
     const Error::Code ERR_TIMEOUT = 4;
+    const Error::Code WARN_FREQUENCY_NOT_ACHIEVABLE = 5;
 
 
     // Common functions
@@ -182,6 +194,11 @@ namespace I2C {
 
     // Master-mode functions
     bool enableMaster(Port port, unsigned int frequency=100000);
+    unsigned int setTiming(Port port, unsigned int frequency, unsigned int busCapacitance=DEFAULT_BUS_CAPACITANCE, unsigned int pullUp=DEFAULT_PULLUP, unsigned int riseTime=0);
+    unsigned int enableHighSpeed(Port port, unsigned int frequency=FREQUENCY_HIGH_SPEED, uint8_t masterCode=1, unsigned int busCapacitance=DEFAULT_BUS_CAPACITANCE, unsigned int pullUp=DEFAULT_PULLUP, unsigned int riseTime=0);
+    void disableHighSpeed(Port port, unsigned int frequency=0);
+    unsigned int autoTune(Port port, uint8_t address, int nBytes=8);
+    unsigned int getFrequency(Port port);
     unsigned int read(Port port, uint8_t address, uint8_t* buffer, int n, bool* acked=nullptr);
     uint8_t read(Port port, uint8_t address, bool* acked=nullptr);
     bool write(Port port, uint8_t address, const uint8_t* buffer, int n);
@@ -189,6 +206,8 @@ namespace I2C {
     unsigned int writeRead(Port port, uint8_t address, const uint8_t* txBuffer, int nTX, uint8_t* rxBuffer, int nRX, bool* acked=nullptr);
     unsigned int writeRead(Port port, uint8_t address, uint8_t byte, uint8_t* rxBuffer, int nRX, bool* acked=nullptr);
     bool testAddress(Port port, uint8_t address, Dir direction);
+    bool writeReadAsync(Port port, uint8_t address, const uint8_t* txBuffer, int nTX, uint8_t* rxBuffer, int nRX, Callback<Port, bool> handler=nullptr);
+    bool isAsyncTransferFinished(Port port);
 
     // Slave-mode functions
     bool enableSlave(Port port, uint8_t address);
@@ -199,7 +218,9 @@ namespace I2C {
     int getAsyncReadCounter(Port port);
     int getAsyncReadBytesSent(Port port);
     int getAsyncWriteCounter(Port port);
-    void enableInterrupt(Port port, void (*handler)(), Interrupt interrupt);
+    void enableInterrupt(Port port, Callback<> handler, Interrupt interrupt);
+    bool enableSlaveRegisterFile(Port port, uint8_t address, uint8_t* registers, int size, Callback<Port, int, int> handler=nullptr);
+    void setRegisterPointer(Port port, int pointer);
 
 }
 
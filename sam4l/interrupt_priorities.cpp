@@ -1,10 +1,12 @@
 #include <stdint.h>
+#include "adc.h"
 #include "ast.h"
 #include "bpm.h"
 #include "dma.h"
 #include "eic.h"
 #include "gpio.h"
 #include "i2c.h"
+#include "kernel.h"
 #include "pm.h"
 #include "tc.h"
 #include "trng.h"
@@ -14,6 +16,10 @@
 // Note : a high number means a lower priority.
 // The highest priority is 1.
 
+namespace ADC {
+    uint8_t INTERRUPT_PRIORITY = 30;
+}
+
 namespace AST {
     uint8_t INTERRUPT_PRIORITY = 100;
 }
@@ -38,6 +44,10 @@ namespace I2C {
     uint8_t INTERRUPT_PRIORITY = 10;
 }
 
+namespace Kernel {
+    uint8_t INTERRUPT_PRIORITY = 240; // SysTick
+}
+
 namespace PM {
     uint8_t INTERRUPT_PRIORITY = 2;
 }
@@ -0,0 +1,502 @@
+#include "kernel.h"
+#include "core.h"
+#include "pm.h"
+
+// Memory area reserved for the threads stacks, defined in common.ld
+extern uint32_t SECTION_THREAD_STACKS_START;
+extern uint32_t SECTION_THREAD_STACKS_END;
+
+namespace Kernel {
+
+    // Interrupt priority of the SysTick, defined in interrupt_priorities.cpp.
+    // PendSV always has the lowest possible priority.
+    extern uint8_t INTERRUPT_PRIORITY;
+
+    enum class State {
+        UNUSED,
+        READY,
+        SLEEPING,
+        BLOCKED,
+    };
+
+    struct ThreadData {
+        uint32_t sp = 0;
+        uint8_t priority = 0;
+        State state = State::UNUSED;
+        unsigned long wakeTick = 0;
+        bool acquired = false;
+        volatile Thread next = -1; // Next thread in the same waiting list
+        volatile Thread* waitList = nullptr; // Head of the waiting list this thread is in, if any
+    };
+
+    // The idle thread runs when no other thread is ready. It has its own priority
+    // level, below all the levels available to the user.
+    const Thread IDLE_THREAD = MAX_THREADS;
+    const int IDLE_PRIORITY = N_PRIORITIES;
+    const unsigned int IDLE_STACK_SIZE = 256; // bytes
+
+    ThreadData _threads[MAX_THREADS + 1];
+    uint32_t _idleStack[IDLE_STACK_SIZE / sizeof(uint32_t)] __attribute__ ((aligned (8)));
+
+    // Ready list : a bitmask of the ready threads for each priority level, and a bitmask
+    // of the levels which have at least one ready thread. The next thread to run is found
+    // with two CTZ instructions, whatever the number of threads.
+    volatile uint32_t _readyThreads[N_PRIORITIES + 1];
+    volatile uint32_t _readyPriorities = 0;
+
+    // Threads which must be woken up by the tick at their wakeTick
+    volatile uint32_t _timedThreads = 0;
+
+    volatile Thread _current = -1;
+    volatile bool _rotate = false;
+    volatile unsigned long _ticks = 0;
+    bool _initialized = false;
+    bool _started = false;
+
+    // The first context switch saves the registers of main() in this area, which is then abandoned
+    uint32_t _startFrame[8];
+
+    // Allocation cursor in the thread stacks section
+    uint32_t _stacksCursor = 0;
+
+    void initThread(Thread t, void (*function)(), uint32_t* stack, unsigned int stackSize, uint8_t priority);
+    void idle();
+    void threadExit();
+    void tickHandler();
+    void handlerPendSV();
+
+
+    // Initialize the kernel and create the idle thread
+    void init() {
+        if (_initialized) {
+            return;
+        }
+
+        for (int i = 0; i <= N_PRIORITIES; i++) {
+            _readyThreads[i] = 0;
+        }
+        _stacksCursor = ((uint32_t)&SECTION_THREAD_STACKS_START + 7) & ~(uint32_t)7;
+
+        // Exception handlers
+        Core::setExceptionHandler(Core::Exception::PENDSV, handlerPendSV);
+        Core::setExceptionHandler(Core::Exception::SYSTICK, tickHandler);
+
+        // SHPR3 (System Handler Priority Register 3) : PendSV has the lowest priority, so that
+        // a context switch is only performed when every interrupt has been handled
+        (*(volatile uint32_t*) Core::SHPR3)
+            = ((*(volatile uint32_t*) Core::SHPR3) & 0x0000FFFF)
+            | 0xFF << 16                                // PRI_14 : PendSV
+            | (uint32_t)INTERRUPT_PRIORITY << 24;       // PRI_15 : SysTick
+
+        // The idle thread uses a reserved slot and priority level
+        initThread(IDLE_THREAD, idle, _idleStack, IDLE_STACK_SIZE, IDLE_PRIORITY);
+
+        // Let the drivers give the CPU to other threads while they are waiting for a peripheral
+        Core::setYieldHandler(yield);
+
+        _initialized = true;
+    }
+
+    // Internal helpers to maintain the ready list, which must be called in a critical section
+    void setReady(Thread t) {
+        int priority = _threads[t].priority;
+        _threads[t].state = State::READY;
+        _readyThreads[priority] |= 1 << t;
+        _readyPriorities |= 1 << priority;
+    }
+
+    void clearReady(Thread t) {
+        int priority = _threads[t].priority;
+        _readyThreads[priority] &= ~(uint32_t)(1 << t);
+        if (_readyThreads[priority] == 0) {
+            _readyPriorities &= ~(uint32_t)(1 << priority);
+        }
+    }
+
+    // Request a context switch, which will be performed by PendSV as soon as
+    // every interrupt has been handled and interrupts are enabled
+    inline void requestSwitch() {
+        // ICSR (Interrupt Control and State Register) : set PendSV as pending
+        (*(volatile uint32_t*) Core::ICSR) = 1 << Core::ICSR_PENDSVSET;
+    }
+
+    inline bool inInterrupt() {
+        // ICSR (Interrupt Control and State Register) : VECTACTIVE is 0 in thread mode
+        return ((*(volatile uint32_t*) Core::ICSR) & 0x1FF) != 0;
+    }
+
+    // Create a thread with a stack allocated in the .thread_stacks section. Stacks are never freed,
+    // but the slot of a thread which has returned can be reused.
+    Thread createThread(void (*function)(), unsigned int stackSize, uint8_t priority) {
+        if (stackSize < MIN_STACK_SIZE) {
+            stackSize = MIN_STACK_SIZE;
+        }
+        stackSize = (stackSize + 7) & ~(unsigned int)7;
+
+        uint32_t primask = Core::enterCriticalSection();
+        if (_stacksCursor + stackSize > (uint32_t)&SECTION_THREAD_STACKS_END) {
+            Core::exitCriticalSection(primask);
+            Error::happened(Error::Module::KERNEL, ERR_STACK_POOL_EXHAUSTED, Error::Severity::CRITICAL);
+            return -1;
+        }
+        uint32_t* stack = (uint32_t*)_stacksCursor;
+        _stacksCursor += stackSize;
+        Core::exitCriticalSection(primask);
+
+        return createThread(function, stack, stackSize, priority);
+    }
+
+    // Create a thread with a user-provided stack. A higher priority number means a lower priority.
+    Thread createThread(void (*function)(), uint32_t* stack, unsigned int stackSize, uint8_t priority) {
+        if (priority >= N_PRIORITIES) {
+            Error::happened(Error::Module::KERNEL, ERR_INVALID_PRIORITY, Error::Severity::CRITICAL);
+            return -1;
+        }
+        if (!_initialized) {
+            init();
+        }
+
+        uint32_t primask = Core::enterCriticalSection();
+
+        // Find a free slot
+        Thread t = 0;
+        while (t < MAX_THREADS && _threads[t].state != State::UNUSED) {
+            t++;
+        }
+        if (t == MAX_THREADS) {
+            Core::exitCriticalSection(primask);
+            Error::happened(Error::Module::KERNEL, ERR_TOO_MANY_THREADS, Error::Severity::CRITICAL);
+            return -1;
+        }
+
+        initThread(t, function, stack, stackSize, priority);
+
+        // Preempt the current thread if the new one has a higher priority
+        if (_started && priority < _threads[_current].priority) {
+            requestSwitch();
+        }
+
+        Core::exitCriticalSection(primask);
+        return t;
+    }
+
+    // Build the initial frame of a thread, as if it had been interrupted just before its first
+    // instruction : the hardware-saved frame (xPSR, PC, LR, R12, R3-R0) followed by R11-R4.
+    // See ARMv7-M Architecture Reference Manual, B1.5.6 "Exception entry behavior".
+    void initThread(Thread t, void (*function)(), uint32_t* stack, unsigned int stackSize, uint8_t priority) {
+        uint32_t* sp = (uint32_t*)(((uint32_t)stack + stackSize) & ~(uint32_t)7);
+        *(--sp) = 1 << 24;                              // xPSR : Thumb state
+        *(--sp) = (uint32_t)function & ~(uint32_t)1;    // PC
+        *(--sp) = (uint32_t)threadExit;                 // LR : called if the thread returns
+        for (int i = 0; i < 5 + 8; i++) {               // R12, R3-R0, R11-R4
+            *(--sp) = 0;
+        }
+
+        _threads[t].sp = (uint32_t)sp;
+        _threads[t].priority = priority;
+        _threads[t].next = -1;
+        _threads[t].waitList = nullptr;
+        setReady(t);
+    }
+
+    // Start the tick and run the threads. main() is abandoned and this function never returns.
+    void start() {
+        if (!_initialized) {
+            init();
+        }
+
+        // SysTick : generate the tick. The counter keeps its clock source so that
+        // Core::waitMicroseconds() can still use it.
+        Core::disableInterrupts();
+        (*(volatile uint32_t*) Core::SYST_RVR) = PM::getCPUClockFrequency() / TICK_FREQUENCY - 1;
+        (*(volatile uint32_t*) Core::SYST_CVR) = 0;
+        (*(volatile uint32_t*) Core::SYST_CSR)
+            = 1 << Core::SYST_CSR_ENABLE      // Enable counter
+            | 1 << Core::SYST_CSR_TICKINT;    // Enable interrupt when the counter reaches 0
+
+        // The first PendSV saves the context of main() in a scratch area and switches to the
+        // highest-priority thread. Every thread then runs on the process stack (PSP), while
+        // exceptions keep using the main stack (MSP).
+        __asm__ __volatile__ ("MSR PSP, %0" :: "r" (&_startFrame[8]));
+        _current = -1;
+        _started = true;
+        requestSwitch();
+        Core::enableInterrupts();
+
+        while (1);
+    }
+
+    bool isStarted() {
+        return _started;
+    }
+
+    Thread currentThread() {
+        return _current;
+    }
+
+    unsigned long ticks() {
+        return _ticks;
+    }
+
+    // Let the other ready threads of the same priority run. Lower-priority threads are not
+    // scheduled : use sleep() or a blocking primitive to give them the CPU.
+    void yield() {
+        if (!_started || inInterrupt()) {
+            return;
+        }
+        uint32_t primask = Core::enterCriticalSection();
+        _rotate = true;
+        requestSwitch();
+        Core::exitCriticalSection(primask);
+    }
+
+    // Suspend the current thread for the given number of milliseconds
+    void sleep(unsigned long ms) {
+        if (!_started) {
+            Core::sleep(ms);
+            return;
+        }
+        if (ms == 0) {
+            yield();
+            return;
+        }
+        uint32_t primask = Core::enterCriticalSection();
+        Thread t = _current;
+        clearReady(t);
+        _threads[t].state = State::SLEEPING;
+        _threads[t].wakeTick = _ticks + ms * TICK_FREQUENCY / 1000;
+        _timedThreads |= 1 << t;
+        requestSwitch();
+        Core::exitCriticalSection(primask);
+    }
+
+    // Called when a thread function returns
+    void threadExit() {
+        Core::disableInterrupts();
+        clearReady(_current);
+        _threads[_current].state = State::UNUSED;
+        requestSwitch();
+        Core::enableInterrupts();
+        while (1);
+    }
+
+    void idle() {
+        while (1) {
+            Core::waitForInterrupt();
+        }
+    }
+
+
+    // Waiting lists, sorted by priority and in FIFO order for threads of the same priority.
+    // These functions must be called in a critical section.
+    void addToWaitList(volatile Thread* list, Thread t) {
+        volatile Thread* p = list;
+        while (*p >= 0 && _threads[*p].priority <= _threads[t].priority) {
+            p = &_threads[*p].next;
+        }
+        _threads[t].next = *p;
+        _threads[t].waitList = list;
+        *p = t;
+    }
+
+    void removeFromWaitList(Thread t) {
+        volatile Thread* p = _threads[t].waitList;
+        while (p != nullptr && *p >= 0) {
+            if (*p == t) {
+                *p = _threads[t].next;
+                break;
+            }
+            p = &_threads[*p].next;
+        }
+        _threads[t].next = -1;
+        _threads[t].waitList = nullptr;
+    }
+
+    // Block the current thread on a waiting list. The context switch happens as soon as the
+    // caller leaves its critical section.
+    void blockCurrent(volatile Thread* list, unsigned long timeout) {
+        Thread t = _current;
+        clearReady(t);
+        _threads[t].state = State::BLOCKED;
+        _threads[t].acquired = false;
+        addToWaitList(list, t);
+        if (timeout > 0) {
+            _threads[t].wakeTick = _ticks + timeout * TICK_FREQUENCY / 1000;
+            _timedThreads |= 1 << t;
+        }
+        requestSwitch();
+    }
+
+    // Wake up the first thread of a waiting list and return it, or -1 if the list is empty
+    Thread wakeFirst(volatile Thread* list) {
+        Thread t = *list;
+        if (t < 0) {
+            return -1;
+        }
+        *list = _threads[t].next;
+        _threads[t].next = -1;
+        _threads[t].waitList = nullptr;
+        _threads[t].acquired = true;
+        _timedThreads &= ~(uint32_t)(1 << t);
+        setReady(t);
+        if (_current < 0 || _threads[t].priority < _threads[_current].priority) {
+            requestSwitch();
+        }
+        return t;
+    }
+
+
+    // Mutexes are handed over directly to the highest-priority waiting thread when they
+    // are unlocked. There is no priority inheritance. These functions must be called from
+    // a thread, with interrupts enabled.
+    void lock(Mutex& mutex) {
+        if (!_started) {
+            return;
+        }
+        uint32_t primask = Core::enterCriticalSection();
+        if (mutex.owner < 0) {
+            mutex.owner = _current;
+        } else {
+            // unlock() will set this thread as the owner before waking it up
+            blockCurrent(&mutex.waiting, 0);
+        }
+        Core::exitCriticalSection(primask);
+    }
+
+    bool tryLock(Mutex& mutex) {
+        if (!_started) {
+            return true;
+        }
+        uint32_t primask = Core::enterCriticalSection();
+        bool locked = mutex.owner < 0;
+        if (locked) {
+            mutex.owner = _current;
+        }
+        Core::exitCriticalSection(primask);
+        return locked;
+    }
+
+    void unlock(Mutex& mutex) {
+        if (!_started) {
+            return;
+        }
+        if (mutex.owner != _current) {
+            Error::happened(Error::Module::KERNEL, ERR_NOT_OWNER, Error::Severity::WARNING);
+            return;
+        }
+        uint32_t primask = Core::enterCriticalSection();
+        mutex.owner = wakeFirst(&mutex.waiting);
+        Core::exitCriticalSection(primask);
+    }
+
+    // Take the semaphore, waiting at most timeout milliseconds (or forever if timeout is 0).
+    // Return false if the timeout expired. Must be called from a thread.
+    bool take(Semaphore& semaphore, unsigned long timeout) {
+        uint32_t primask = Core::enterCriticalSection();
+        if (semaphore.count > 0) {
+            semaphore.count--;
+            Core::exitCriticalSection(primask);
+            return true;
+        }
+        if (!_started || inInterrupt()) {
+            Core::exitCriticalSection(primask);
+            return false;
+        }
+        blockCurrent(&semaphore.waiting, timeout);
+        Core::exitCriticalSection(primask);
+
+        // The thread is running again : either give() has handed the semaphore over, or the timeout expired
+        return _threads[_current].acquired;
+    }
+
+    // Give the semaphore. This function can be called from an interrupt handler.
+    void give(Semaphore& semaphore) {
+        uint32_t primask = Core::enterCriticalSection();
+        if (wakeFirst(&semaphore.waiting) < 0) {
+            semaphore.count++;
+        }
+        Core::exitCriticalSection(primask);
+    }
+
+
+    void tickHandler() {
+        uint32_t primask = Core::enterCriticalSection();
+        _ticks++;
+
+        // Wake up the threads whose delay has expired
+        uint32_t timed = _timedThreads;
+        while (timed) {
+            Thread t = __builtin_ctz(timed);
+            timed &= timed - 1;
+            if ((long)(_ticks - _threads[t].wakeTick) >= 0) {
+                if (_threads[t].state == State::BLOCKED) {
+                    removeFromWaitList(t);
+                    _threads[t].acquired = false;
+                }
+                _timedThreads &= ~(uint32_t)(1 << t);
+                setReady(t);
+                requestSwitch();
+            }
+        }
+
+        // Time slicing : share the CPU with the other ready threads of the same priority
+        if (_current >= 0 && _readyThreads[_threads[_current].priority] & ~(uint32_t)(1 << _current)) {
+            _rotate = true;
+            requestSwitch();
+        }
+        Core::exitCriticalSection(primask);
+    }
+
+    // Called by PendSV with the stack pointer of the current thread, after its registers have
+    // been saved on its stack. Select the next thread and return its stack pointer.
+    extern "C" uint32_t kernelSwitchContext(uint32_t sp) {
+        Thread current = _current;
+        if (current >= 0) {
+            _threads[current].sp = sp;
+        }
+
+        // Highest ready priority level (the idle thread is always ready)
+        int priority = __builtin_ctz(_readyPriorities);
+        uint32_t candidates = _readyThreads[priority];
+
+        // Keep the current thread unless it is not ready anymore, a thread with a higher priority is
+        // ready, or it has to give the CPU to the next thread of the same priority (round-robin)
+        Thread next = current;
+        if (current < 0 || !(candidates & (1 << current)) || _rotate) {
+            uint32_t after = current >= 0 ? candidates & ~(uint32_t)((2 << current) - 1) : 0;
+            next = __builtin_ctz(after != 0 ? after : candidates);
+        }
+        _rotate = false;
+        _current = next;
+        return _threads[next].sp;
+    }
+
+    // Called by PendSV before the context switch
+    extern "C" void kernelRunDeferredWork() {
+        Core::runDeferredWork();
+    }
+
+    // Context switch : save R4-R11 on the stack of the current thread, select the next thread,
+    // and restore its registers. The other registers are saved by the hardware on exception entry.
+    // EXC_RETURN is forced to return to thread mode on the PSP, which is needed for the first switch.
+    // The deferred work queue of the Core module is drained first, with interrupts enabled, so that
+    // the threads woken up by the work items are taken into account by this switch.
+    __attribute__ ((naked)) void handlerPendSV() {
+        __asm__ __volatile__ (
+            "PUSH {R4, LR} \n\t"
+            "BL kernelRunDeferredWork \n\t"
+            "POP {R4, LR} \n\t"
+            "CPSID I \n\t"
+            "MRS R0, PSP \n\t"
+            "STMDB R0!, {R4-R11} \n\t"
+            "MOV R4, LR \n\t"
+            "BL kernelSwitchContext \n\t"
+            "ORR LR, R4, #4 \n\t"
+            "LDMIA R0!, {R4-R11} \n\t"
+            "MSR PSP, R0 \n\t"
+            "CPSIE I \n\t"
+            "BX LR \n\t"
+        );
+    }
+
+}
@@ -0,0 +1,65 @@
+#ifndef _KERNEL_H_
+#define _KERNEL_H_
+
+#include <stdint.h>
+#include "error.h"
+
+// Preemptive kernel
+// This module runs several threads, each with its own stack and priority. The SysTick
+// generates a 1ms tick which wakes up sleeping threads and shares the CPU between ready
+// threads of the same priority, and the context switch itself is performed in the
+// PendSV handler, which has the lowest priority so that it never delays an interrupt.
+// A ready thread always preempts the threads with a lower priority (a higher number).
+// Threads stacks are allocated from the .thread_stacks section of the linker script,
+// whose size is set with THREAD_STACKS_SIZE in the project Makefile.
+// Once the kernel is started, the SysTick is no longer a free-running counter :
+// Core::waitMicroseconds() still works since it takes the reload value into account.
+namespace Kernel {
+
+    const int MAX_THREADS = 16;
+    const int N_PRIORITIES = 8;
+    const unsigned int MIN_STACK_SIZE = 256; // bytes
+    const unsigned long TICK_FREQUENCY = 1000; // Hz
+
+    // Error codes
+    const Error::Code ERR_TOO_MANY_THREADS = 0x0001;
+    const Error::Code ERR_STACK_POOL_EXHAUSTED = 0x0002;
+    const Error::Code ERR_INVALID_PRIORITY = 0x0003;
+    const Error::Code ERR_NOT_OWNER = 0x0004;
+
+    using Thread = int;
+
+    // Threads waiting for a mutex or a semaphore are linked in a list sorted by priority,
+    // so that the object can be handed over directly to the best candidate
+    struct Mutex {
+        volatile Thread owner = -1;
+        volatile Thread waiting = -1;
+    };
+
+    struct Semaphore {
+        volatile unsigned int count = 0;
+        volatile Thread waiting = -1;
+    };
+
+
+    // Module API
+    void init();
+    Thread createThread(void (*function)(), unsigned int stackSize, uint8_t priority);
+    Thread createThread(void (*function)(), uint32_t* stack, unsigned int stackSize, uint8_t priority);
+    void start();
+    bool isStarted();
+    Thread currentThread();
+    unsigned long ticks();
+    void yield();
+    void sleep(unsigned long ms);
+
+    // Synchronization primitives
+    void lock(Mutex& mutex);
+    bool tryLock(Mutex& mutex);
+    void unlock(Mutex& mutex);
+    bool take(Semaphore& semaphore, unsigned long timeout=0);
+    void give(Semaphore& semaphore);
+
+}
+
+#endif
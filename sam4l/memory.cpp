@@ -0,0 +1,276 @@
+#include "memory.h"
+#include "core.h"
+#include "pm.h"
+#include "dma.h"
+#include "spi.h"
+
+namespace Memory {
+
+    // Maximum length of a single DMA transfer (TCR is 16-bit)
+    const unsigned int MAX_CHUNK_SIZE = 0xFFFF & ~1;
+
+    bool _asyncEnabled = false;
+    int _rxDMAChannel = -1;
+    int _txDMAChannel = -1;
+
+    // State of the current asynchronous copy
+    volatile bool _asyncRunning = false;
+    uint8_t* _asyncDst = nullptr;
+    const uint8_t* _asyncSrc = nullptr;
+    unsigned int _asyncRemaining = 0;
+    Callback<> _asyncHandler;
+    void rxFinishedHandler();
+
+    // Copy n bytes from src to dst. When both buffers have the same alignment, the bulk of the
+    // data is copied in bursts of 32 bytes with LDM/STM, which take one cycle per word plus one
+    // cycle per instruction.
+    void copy(void* dst, const void* src, unsigned int n) {
+        uint8_t* d = (uint8_t*)dst;
+        const uint8_t* s = (const uint8_t*)src;
+
+        if ((((uint32_t)d ^ (uint32_t)s) & 0b11) == 0) {
+            // Copy the first bytes until the buffers are word-aligned
+            while (((uint32_t)d & 0b11) && n > 0) {
+                *d++ = *s++;
+                n--;
+            }
+
+            // Copy 32-byte blocks (r7 is skipped since it may be used as the frame pointer)
+            while (n >= 32) {
+                __asm__ __volatile__ (
+                    "ldmia %[s]!, {r3-r6, r8-r10, r12} \n\t"
+                    "stmia %[d]!, {r3-r6, r8-r10, r12} \n\t"
+                    : [s] "+r" (s), [d] "+r" (d)
+                    :
+                    : "r3", "r4", "r5", "r6", "r8", "r9", "r10", "r12", "memory"
+                );
+                n -= 32;
+            }
+
+            // Copy the remaining words
+            while (n >= 4) {
+                *(uint32_t*)d = *(const uint32_t*)s;
+                d += 4;
+                s += 4;
+                n -= 4;
+            }
+        }
+
+        // Copy the remaining bytes (or the whole buffer if the alignments differ)
+        while (n > 0) {
+            *d++ = *s++;
+            n--;
+        }
+    }
+
+    // Fill n bytes of dst with the given value, using STM bursts of 16 bytes
+    void fill(void* dst, uint8_t value, unsigned int n) {
+        uint8_t* d = (uint8_t*)dst;
+
+        // Fill the first bytes until the buffer is word-aligned
+        while (((uint32_t)d & 0b11) && n > 0) {
+            *d++ = value;
+            n--;
+        }
+
+        // Fill 16-byte blocks
+        uint32_t word = value * 0x01010101;
+        unsigned int blocks = n / 16;
+        if (blocks > 0) {
+            __asm__ __volatile__ (
+                "mov r3, %[w] \n\t"
+                "mov r4, %[w] \n\t"
+                "mov r5, %[w] \n\t"
+                "mov r6, %[w] \n\t"
+                "1: \n\t"
+                "stmia %[d]!, {r3-r6} \n\t"
+                "subs %[b], %[b], #1 \n\t"
+                "bne 1b \n\t"
+                : [d] "+r" (d), [b] "+r" (blocks)
+                : [w] "r" (word)
+                : "r3", "r4", "r5", "r6", "cc", "memory"
+            );
+            n %= 16;
+        }
+
+        // Fill the remaining words and bytes
+        while (n >= 4) {
+            *(uint32_t*)d = word;
+            d += 4;
+            n -= 4;
+        }
+        while (n > 0) {
+            *d++ = value;
+            n--;
+        }
+    }
+
+    // Reserve the SPI controller and two DMA channels for asynchronous copies. The chip has a single
+    // SPI controller : this fails if it is currently enabled, e.g. by the SPI module.
+    bool enableAsync() {
+        if (_asyncEnabled) {
+            return true;
+        }
+
+        // PBAMASK (PBA Mask) and SR (Status Register) : check if the SPI controller is clocked and enabled
+        if (((*(volatile uint32_t*)(PM::BASE + PM::OFFSET_PBAMASK)) & (1 << PM::PBAMASK_SPI))
+                && ((*(volatile uint32_t*)(SPI::SPI_BASE + SPI::OFFSET_SR)) & (1 << SPI::SR_SPIENS))) {
+            Error::happened(Error::Module::MEMORY, ERR_SPI_IN_USE, Error::Severity::WARNING);
+            return false;
+        }
+
+        // Enable the clock
+        PM::enablePeripheralClock(PM::CLK_SPI);
+
+        // CR (Control Register) : reset the interface
+        (*(volatile uint32_t*)(SPI::SPI_BASE + SPI::OFFSET_CR))
+            = 1 << SPI::CR_SWRST;         // SWRST : software reset
+
+        // MR (Mode Register) : configure the interface in master mode with local loopback.
+        // The pins are not used : MISO is internally connected to MOSI.
+        (*(volatile uint32_t*)(SPI::SPI_BASE + SPI::OFFSET_MR))
+            = 1 << SPI::MR_MSTR           // MSTR : master mode
+            | 0 << SPI::MR_PS             // PS : fixed peripheral select
+            | 1 << SPI::MR_MODFDIS        // MODFDIS : mode fault detection disabled
+            | 1 << SPI::MR_RXFIFOEN       // RXFIFOEN : reception fifo enabled
+            | 1 << SPI::MR_LLB            // LLB : local loopback enabled
+            | 0b1110 << SPI::MR_PCS;      // PCS : peripheral 0
+
+        // CSR0 (Chip Select Register 0) : fastest clock, 8-bit transfers
+        (*(volatile uint32_t*)(SPI::SPI_BASE + SPI::OFFSET_CSR0))
+            = 1 << SPI::CSR_SCBR          // SCBR : SPCK = CLK_SPI
+            | 0 << SPI::CSR_BITS;         // BITS : 8 bits
+
+        // CR (Control Register) : enable the interface
+        (*(volatile uint32_t*)(SPI::SPI_BASE + SPI::OFFSET_CR))
+            = 1 << SPI::CR_SPIEN;         // SPIEN : SPI Enable
+
+        // Set up the DMA channels
+        _rxDMAChannel = DMA::setupChannel(_rxDMAChannel, DMA::Device::SPI_RX, DMA::Size::BYTE);
+        _txDMAChannel = DMA::setupChannel(_txDMAChannel, DMA::Device::SPI_TX, DMA::Size::BYTE);
+        if (_rxDMAChannel < 0 || _txDMAChannel < 0) {
+            disableAsync();
+            return false;
+        }
+
+        // The Transfer Complete interrupt is only enabled by startChunk(), once the channel has
+        // something to transfer : the flag stays set while TCR is zero, so enabling it on an idle
+        // channel would call the handler immediately
+
+        _asyncEnabled = true;
+        return true;
+    }
+
+    // Release the SPI controller and the DMA channels
+    void disableAsync() {
+        if (_rxDMAChannel > -1) {
+            DMA::freeChannel(_rxDMAChannel);
+            _rxDMAChannel = -1;
+        }
+        if (_txDMAChannel > -1) {
+            DMA::freeChannel(_txDMAChannel);
+            _txDMAChannel = -1;
+        }
+
+        // CR (Control Register) : disable the interface
+        (*(volatile uint32_t*)(SPI::SPI_BASE + SPI::OFFSET_CR))
+            = 1 << SPI::CR_SPIDIS;        // SPIDIS : SPI Disable
+
+        // Disable the clock
+        PM::disablePeripheralClock(PM::CLK_SPI);
+
+        _asyncEnabled = false;
+        _asyncRunning = false;
+    }
+
+    // Internal function which starts the transfer of the next chunk of the current copy.
+    // Chunks are transferred 16 bits at a time when the buffers allow it, which halves the
+    // number of SPI frames.
+    void startChunk() {
+        unsigned int n = _asyncRemaining;
+        if (n > MAX_CHUNK_SIZE) {
+            n = MAX_CHUNK_SIZE;
+        }
+        bool halfword = (((uint32_t)_asyncDst | (uint32_t)_asyncSrc | n) & 1) == 0;
+        DMA::Size size = halfword ? DMA::Size::HALFWORD : DMA::Size::BYTE;
+
+        // CSR0 (Chip Select Register 0) : frame size
+        (*(volatile uint32_t*)(SPI::SPI_BASE + SPI::OFFSET_CSR0))
+            = 1 << SPI::CSR_SCBR          // SCBR : SPCK = CLK_SPI
+            | (halfword ? 0b1000 : 0) << SPI::CSR_BITS; // BITS : 8 or 16 bits
+
+        // Configure the channels, the RX channel must be ready before the first frame is sent
+        DMA::setupChannel(_rxDMAChannel, DMA::Device::SPI_RX, size);
+        DMA::setupChannel(_txDMAChannel, DMA::Device::SPI_TX, size);
+        uint8_t* dst = _asyncDst;
+        const uint8_t* src = _asyncSrc;
+        _asyncDst += n;
+        _asyncSrc += n;
+        _asyncRemaining -= n;
+        DMA::startChannel(_rxDMAChannel, (uint32_t)dst, halfword ? n / 2 : n);
+        DMA::startChannel(_txDMAChannel, (uint32_t)src, halfword ? n / 2 : n);
+
+        // Enable the Transfer Complete interrupt only now that TCR is not zero anymore : the flag
+        // is a level which is set as long as TCR and TCRR are both zero, so enabling it earlier
+        // would call rxFinishedHandler() (and this function) again before the state is updated
+        DMA::enableInterrupt(_rxDMAChannel, rxFinishedHandler, DMA::Interrupt::TRANSFER_FINISHED);
+    }
+
+    // Copy n bytes from src to dst in background and call the handler (from the DMA interrupt)
+    // when the copy is finished. Both buffers must stay valid until then.
+    bool copyAsync(void* dst, const void* src, unsigned int n, Callback<> handler) {
+        if (!_asyncEnabled) {
+            Error::happened(Error::Module::MEMORY, ERR_ASYNC_NOT_ENABLED, Error::Severity::CRITICAL);
+            return false;
+        }
+        if (_asyncRunning) {
+            Error::happened(Error::Module::MEMORY, ERR_ASYNC_BUSY, Error::Severity::WARNING);
+            return false;
+        }
+
+        _asyncDst = (uint8_t*)dst;
+        _asyncSrc = (const uint8_t*)src;
+        _asyncRemaining = n;
+        _asyncHandler = handler;
+
+        // Nothing to do
+        if (n == 0) {
+            if (handler) {
+                handler();
+            }
+            return true;
+        }
+
+        _asyncRunning = true;
+        startChunk();
+        return true;
+    }
+
+    bool isAsyncFinished() {
+        return !_asyncRunning;
+    }
+
+    void rxFinishedHandler() {
+        // The interrupt is only expected while a copy is running
+        if (!_asyncRunning) {
+            DMA::disableInterrupt(_rxDMAChannel, DMA::Interrupt::TRANSFER_FINISHED);
+            return;
+        }
+
+        // Continue with the next chunk if the copy is longer than a single DMA transfer
+        if (_asyncRemaining > 0) {
+            startChunk();
+            return;
+        }
+
+        // The copy is finished : disable the interrupt, stop the channels and call the user handler
+        DMA::disableInterrupt(_rxDMAChannel, DMA::Interrupt::TRANSFER_FINISHED);
+        DMA::stopChannel(_rxDMAChannel);
+        DMA::stopChannel(_txDMAChannel);
+        _asyncRunning = false;
+        if (_asyncHandler) {
+            _asyncHandler();
+        }
+    }
+
+}
@@ -0,0 +1,34 @@
+#ifndef _MEMORY_H_
+#define _MEMORY_H_
+
+#include <stdint.h>
+#include "error.h"
+#include "callback.h"
+
+// Bulk memory operations
+// This module provides fast copy and fill functions using LDM/STM bursts, and an
+// asynchronous copy which offloads the transfer to the DMA. The PDCA can only transfer
+// between memory and peripherals (and the CRCCU DMA can only read), so the asynchronous
+// copy loops the data through the SPI controller in local loopback mode : the TX channel
+// reads the source buffer and the RX channel writes the destination buffer while the CPU
+// is free to do something else. While asynchronous copies are enabled, the SPI controller
+// cannot be used by the SPI module, and enableAsync() fails if the SPI controller is already
+// enabled by the SPI module.
+namespace Memory {
+
+    // Error codes
+    const Error::Code ERR_ASYNC_NOT_ENABLED = 0x0001;
+    const Error::Code ERR_ASYNC_BUSY = 0x0002;
+    const Error::Code ERR_SPI_IN_USE = 0x0003;
+
+    // Module API
+    void copy(void* dst, const void* src, unsigned int n);
+    void fill(void* dst, uint8_t value, unsigned int n);
+    bool enableAsync();
+    void disableAsync();
+    bool copyAsync(void* dst, const void* src, unsigned int n, Callback<> handler=nullptr);
+    bool isAsyncFinished();
+
+}
+
+#endif
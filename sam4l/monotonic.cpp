@@ -0,0 +1,154 @@
+#include "monotonic.h"
+#include "core.h"
+#include "ast.h"
+
+namespace Monotonic {
+
+    // Fractional bits of the nanoseconds conversion factor
+    const int NS_SHIFT = 16;
+
+    // Duration of an AST cycle and of the resynchronization period, in microseconds
+    const Time AST_CYCLE = 1000000 / AST::COUNTER_FREQUENCY + 1;
+    const Time SYNC_PERIOD = ((uint64_t)1 << (SYNC_INTERVAL + 1)) * 1000000 / 32768;
+
+    // The current time is base + ((cycles - baseCycles) * multiplier >> SHIFT). The snapshot is only
+    // modified by sync() inside a critical section, which increments the generation : a reader
+    // which has been preempted while reading the snapshot sees a different generation and retries.
+    // The snapshot also records the sleep counter of the Core : the cycle counter stops while the CPU
+    // sleeps, so a snapshot taken before a sleep is outdated and must be resynchronized on the AST.
+    struct Snapshot {
+        Time base = 0;
+        uint32_t baseCycles = 0;
+        uint32_t multiplier = 0;
+        uint32_t sleepCounter = 0;
+    };
+    volatile Snapshot _snapshot;
+    volatile uint32_t _generation = 0;
+
+    // Calibrated CPU frequency and the corresponding conversion factors
+    unsigned long _frequency = 0;
+    uint32_t _multiplier = 0;
+    uint32_t _nsMultiplier = 0;
+    bool _initialized = false;
+
+    // Internal functions
+    void sync();
+
+
+    // Calibrate the CPU frequency and start the periodic resynchronization on the AST
+    void init() {
+        Core::enableCycleCounter();
+        calibrate();
+
+        // The time starts at the current AST time
+        uint32_t primask = Core::enterCriticalSection();
+        _snapshot.baseCycles = Core::cycles();
+        _snapshot.base = (AST::counter() * 1000000) / AST::COUNTER_FREQUENCY;
+        _snapshot.multiplier = _multiplier;
+        _snapshot.sleepCounter = Core::sleepCounter();
+        _generation = _generation + 1;
+        Core::exitCriticalSection(primask);
+        _initialized = true;
+
+        AST::enablePeriodicInterrupt(SYNC_INTERVAL, sync);
+    }
+
+    // Current time in microseconds. This can be called from any context, including interrupt
+    // handlers of any priority. The first call after the CPU has slept (including in the handler
+    // of the interrupt which woke it up) resynchronizes the clock on the AST, which takes longer.
+    Time now() {
+        while (1) {
+            uint32_t generation = _generation;
+            Time base = _snapshot.base;
+            uint32_t baseCycles = _snapshot.baseCycles;
+            uint32_t multiplier = _snapshot.multiplier;
+            uint32_t sleepCounter = _snapshot.sleepCounter;
+            uint32_t cycles = Core::cycles();
+            if (_generation != generation) {
+                continue;
+            }
+            if (sleepCounter != Core::sleepCounter() && _initialized) {
+                sync();
+                continue;
+            }
+            return base + (((uint64_t)(cycles - baseCycles) * multiplier) >> SHIFT);
+        }
+    }
+
+    // Measure the CPU frequency against the AST. The measurement is aligned on the edges of the
+    // AST counter and takes about 10ms, with interrupts disabled, for a precision of about 20ppm.
+    void calibrate() {
+        Core::enableCycleCounter();
+        volatile uint32_t* cv = (volatile uint32_t*)(AST::BASE + AST::OFFSET_CV);
+
+        uint32_t primask = Core::enterCriticalSection();
+        uint32_t start = *cv;
+        while (*cv == start);
+        uint32_t startCycles = Core::cycles();
+        start++;
+        while (*cv - start < CALIBRATION_CYCLES);
+        uint32_t endCycles = Core::cycles();
+        Core::exitCriticalSection(primask);
+
+        _frequency = ((uint64_t)(endCycles - startCycles) * AST::COUNTER_FREQUENCY) / CALIBRATION_CYCLES;
+        _multiplier = ((uint64_t)1000000 << SHIFT) / _frequency;
+        _nsMultiplier = ((uint64_t)1000000000 << NS_SHIFT) / _frequency;
+
+        // Apply the new frequency from now on
+        if (_initialized) {
+            sync();
+        }
+    }
+
+    // Calibrated CPU frequency in Hz
+    unsigned long frequency() {
+        return _frequency;
+    }
+
+    // Convert a number of cycles to nanoseconds (for durations shorter than about 4s)
+    uint32_t cyclesToNanoseconds(uint32_t cycles) {
+        return ((uint64_t)cycles * _nsMultiplier) >> NS_SHIFT;
+    }
+
+    uint32_t microsecondsToCycles(uint32_t us) {
+        return ((uint64_t)us * _frequency) / 1000000;
+    }
+
+    // Called every SYNC_PERIOD by the AST, and by now() after the CPU has slept, to start a new
+    // snapshot. This resynchronizes the time on the AST, and keeps the 32-bit difference of cycles
+    // from wrapping around.
+    void sync() {
+        uint32_t primask = Core::enterCriticalSection();
+
+        uint32_t cycles = Core::cycles();
+        Time reference = (AST::counter() * 1000000) / AST::COUNTER_FREQUENCY;
+        Time interpolated = _snapshot.base + (((uint64_t)(cycles - _snapshot.baseCycles) * _snapshot.multiplier) >> SHIFT);
+
+        _snapshot.baseCycles = cycles;
+        _snapshot.sleepCounter = Core::sleepCounter();
+        if (interpolated < reference) {
+            // The clock is late (or the CPU has been sleeping) : jump to the AST time
+            _snapshot.base = reference;
+            _snapshot.multiplier = _multiplier;
+
+        } else if (interpolated - reference < AST_CYCLE) {
+            // The AST value is truncated to its last cycle, the clock is on time
+            _snapshot.base = interpolated;
+            _snapshot.multiplier = _multiplier;
+
+        } else {
+            // The clock is early : it cannot go backward, so slow it down for the next period
+            // just enough to let the AST catch up
+            Time excess = interpolated - reference;
+            if (excess > SYNC_PERIOD / 2) {
+                excess = SYNC_PERIOD / 2;
+            }
+            _snapshot.base = interpolated;
+            _snapshot.multiplier = _multiplier - (uint32_t)(((uint64_t)_multiplier * excess) / SYNC_PERIOD);
+        }
+        _generation = _generation + 1;
+
+        Core::exitCriticalSection(primask);
+    }
+
+}
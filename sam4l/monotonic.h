@@ -0,0 +1,43 @@
+#ifndef _MONOTONIC_H_
+#define _MONOTONIC_H_
+
+#include <stdint.h>
+
+// Monotonic clock
+// This module provides a 64-bit time with a microsecond resolution which can be read in a few
+// cycles, from any context, without waiting for the AST clock domain or disabling interrupts.
+// The time is interpolated from the DWT cycle counter (see Core::enableCycleCounter()) and
+// resynchronized every second on the AST, whose 32kHz clock keeps running while the CPU sleeps.
+// The CPU frequency used for the interpolation is measured against the AST by calibrate(), which
+// must be called again after the CPU clock is changed. Since the time never goes backward, a
+// clock which runs ahead of the AST is slowed down slightly until the AST catches up.
+// The cycle counter stops while the CPU sleeps : the clock is resynchronized on the AST by the
+// first call to now() after Core::waitForInterrupt() (used by Core::sleep(), the Kernel and the
+// Scheduler). Code which executes WFI by itself must use Core::waitForInterrupt() instead.
+// Note that the DWT is also enabled on PA23 when a debugger is connected, which prevents this
+// pin from being used by I2C0 once init() has been called, until the chip is reset.
+namespace Monotonic {
+
+    using Time = uint64_t; // microseconds
+
+    // The conversion factors are fixed-point values with this number of fractional bits
+    const int SHIFT = 26;
+
+    // Number of AST cycles over which the CPU frequency is measured (about 10ms)
+    const unsigned int CALIBRATION_CYCLES = 164;
+
+    // Resynchronization period, as an AST periodic interval (2^15 cycles of the 32kHz clock : 1s)
+    const uint8_t SYNC_INTERVAL = 14;
+
+
+    // Module API
+    void init();
+    Time now();
+    void calibrate();
+    unsigned long frequency();
+    uint32_t cyclesToNanoseconds(uint32_t cycles);
+    uint32_t microsecondsToCycles(uint32_t us);
+
+}
+
+#endif
@@ -13,7 +13,7 @@ namespace PM {
 
     // Interrupt handlers
     extern uint8_t INTERRUPT_PRIORITY;
-    uint32_t _interruptHandlers[N_INTERRUPTS];
+    Callback<> _interruptHandlers[N_INTERRUPTS];
     const int _interruptBits[N_INTERRUPTS] = {SR_CFD, SR_CKRDY, SR_WAKE};
     void interruptHandlerWrapper();
     
@@ -181,9 +181,9 @@ namespace PM {
     }
 
 
-    void enableInterrupt(void (*handler)(), Interrupt interrupt) {
+    void enableInterrupt(Callback<> handler, Interrupt interrupt) {
         // Save the user handler
-        _interruptHandlers[static_cast<int>(interrupt)] = (uint32_t)handler;
+        _interruptHandlers[static_cast<int>(interrupt)] = handler;
 
         // IER (Interrupt Enable Register) : enable the requested interrupt (WAKE by default)
         (*(volatile uint32_t*)(BASE + OFFSET_IER))
@@ -210,8 +210,8 @@ namespace PM {
         for (int i = 0; i < N_INTERRUPTS; i++) {
             if ((*(volatile uint32_t*)(BASE + OFFSET_IMR)) & (1 << _interruptBits[i]) // Interrupt is enabled
                     && (*(volatile uint32_t*)(BASE + OFFSET_ISR)) & (1 << _interruptBits[i])) { // Interrupt is pending
-                void (*handler)() = (void (*)())_interruptHandlers[i];
-                if (handler != nullptr) {
+                const Callback<>& handler = _interruptHandlers[i];
+                if (handler) {
                     handler();
                 }
 
@@ -2,6 +2,7 @@
 #define _PM_H_
 
 #include <stdint.h>
+#include "callback.h"
 
 // Power Manager
 // This module controls the clock gating from clock sources to peripherals
@@ -217,7 +218,7 @@ namespace PM {
     void disableWakeUpSources();
 
     // Interrupts
-    void enableInterrupt(void (*handler)(), Interrupt interrupt=Interrupt::WAKE);
+    void enableInterrupt(Callback<> handler, Interrupt interrupt=Interrupt::WAKE);
     void disableInterrupt(Interrupt interrupt=Interrupt::WAKE);
 
 }
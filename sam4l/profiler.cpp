@@ -0,0 +1,315 @@
+#include "profiler.h"
+#include "pm.h"
+
+namespace Profiler {
+
+    struct ProfiledInterrupt {
+        Core::Interrupt interrupt;
+        void (*handler)() = nullptr;
+        bool used = false;
+        bool trace = false;
+        volatile bool raised = false;
+        volatile uint32_t raisedAt = 0;
+        InterruptProfile profile;
+    };
+
+    ProfiledInterrupt _profiledInterrupts[MAX_PROFILED_INTERRUPTS];
+
+    // Slot of each interrupt in _profiledInterrupts plus one, or 0 if it is not profiled
+    uint8_t _slots[Core::N_EXTERNAL_INTERRUPTS];
+
+    // Trace buffer
+    bool _traceEnabled = false;
+    TraceOutput _traceOutput = TraceOutput::BUFFER;
+    TraceEvent _traceBuffer[TRACE_BUFFER_SIZE];
+    uint32_t _traceHead = 0;
+    uint32_t _traceTail = 0;
+    unsigned int _traceOverflows = 0;
+
+    // Internal functions
+    void profiledInterruptHandler(int n);
+    bool interruptHandlerHook(Core::Interrupt interrupt, void (*handler)());
+
+
+    // Enable the cycle counter. This must be called after Core::init(), which disables the DWT.
+    void init() {
+        Core::enableCycleCounter();
+
+        // Keep the instrumented entries in the vector when the drivers install their handlers
+        Core::setInterruptHandlerHook(interruptHandlerHook);
+    }
+
+    // Restore the interrupt handlers and stop the trace. The cycle counter is left running since
+    // other modules may rely on it.
+    void disable() {
+        for (int i = 0; i < MAX_PROFILED_INTERRUPTS; i++) {
+            if (_profiledInterrupts[i].used) {
+                stopProfilingInterrupt(_profiledInterrupts[i].interrupt);
+            }
+        }
+        disableTrace();
+        Core::setInterruptHandlerHook(nullptr);
+    }
+
+    // Add a measurement to the stats. The structure is not protected against concurrent
+    // updates, each Stats should therefore only be used from a single context.
+    void record(Stats& stats, uint32_t cycles) {
+        stats.count++;
+        stats.total += cycles;
+        if (cycles < stats.min) {
+            stats.min = cycles;
+        }
+        if (cycles > stats.max) {
+            stats.max = cycles;
+        }
+    }
+
+    // Add a measurement to the histogram : the bucket is the number of significant bits
+    void record(Histogram& histogram, uint32_t cycles) {
+        int bucket = cycles == 0 ? 0 : 32 - __builtin_clz(cycles);
+        if (bucket >= N_HISTOGRAM_BUCKETS) {
+            bucket = N_HISTOGRAM_BUCKETS - 1;
+        }
+        histogram.buckets[bucket]++;
+    }
+
+    void reset(Stats& stats) {
+        stats = Stats();
+    }
+
+    void reset(Histogram& histogram) {
+        histogram = Histogram();
+    }
+
+
+    // Interrupt profiling
+
+    // Replace the vector entry of the interrupt by an instrumented entry. The current handler,
+    // and any handler installed later by the driver, is called by the instrumented entry.
+    // If trace is true, a trace event is also emitted when the handler is entered and exited.
+    bool profileInterrupt(Core::Interrupt interrupt, bool trace) {
+        if (_slots[static_cast<int>(interrupt)] > 0) {
+            _profiledInterrupts[_slots[static_cast<int>(interrupt)] - 1].trace = trace;
+            return true;
+        }
+
+        // Find a free slot
+        int n = 0;
+        while (n < MAX_PROFILED_INTERRUPTS && _profiledInterrupts[n].used) {
+            n++;
+        }
+        if (n == MAX_PROFILED_INTERRUPTS) {
+            Error::happened(Error::Module::PROFILER, ERR_TOO_MANY_PROFILED_INTERRUPTS, Error::Severity::WARNING);
+            return false;
+        }
+
+        ProfiledInterrupt& p = _profiledInterrupts[n];
+        p.interrupt = interrupt;
+        p.handler = Core::interruptHandler(interrupt);
+        p.used = true;
+        p.trace = trace;
+        p.raised = false;
+        p.profile = InterruptProfile();
+
+        // Install the instrumented entry before the slot is registered, otherwise the hook
+        // would take it for a driver handler
+        Core::setInterruptHandler<profiledInterruptHandler, MAX_PROFILED_INTERRUPTS>(interrupt, n);
+        _slots[static_cast<int>(interrupt)] = n + 1;
+        return true;
+    }
+
+    // Put the driver handler back in the vector
+    void stopProfilingInterrupt(Core::Interrupt interrupt) {
+        int n = _slots[static_cast<int>(interrupt)] - 1;
+        if (n < 0) {
+            return;
+        }
+        _slots[static_cast<int>(interrupt)] = 0;
+        Core::setInterruptHandler(interrupt, _profiledInterrupts[n].handler);
+        _profiledInterrupts[n].used = false;
+    }
+
+    // Mark the moment the event which triggers the interrupt happened (for example, right after
+    // starting a transfer or arming a timer in a test) : the time between this call and the
+    // entry of the handler is recorded in the latency histogram
+    void markRaised(Core::Interrupt interrupt) {
+        int n = _slots[static_cast<int>(interrupt)] - 1;
+        if (n < 0) {
+            return;
+        }
+        _profiledInterrupts[n].raisedAt = cycles();
+        _profiledInterrupts[n].raised = true;
+    }
+
+    // Return the measurements of the interrupt, or nullptr if it is not profiled
+    const InterruptProfile* interruptProfile(Core::Interrupt interrupt) {
+        int n = _slots[static_cast<int>(interrupt)] - 1;
+        if (n < 0) {
+            return nullptr;
+        }
+        return &_profiledInterrupts[n].profile;
+    }
+
+    void resetInterruptProfile(Core::Interrupt interrupt) {
+        int n = _slots[static_cast<int>(interrupt)] - 1;
+        if (n < 0) {
+            return;
+        }
+        uint32_t primask = Core::enterCriticalSection();
+        _profiledInterrupts[n].profile = InterruptProfile();
+        Core::exitCriticalSection(primask);
+    }
+
+    // Instrumented entry of each slot, installed directly in the vector table
+    void profiledInterruptHandler(int n) {
+        uint32_t start = cycles();
+        ProfiledInterrupt& p = _profiledInterrupts[n];
+
+        if (p.raised) {
+            p.raised = false;
+            record(p.profile.latencyHistogram, start - p.raisedAt);
+        }
+        if (p.trace) {
+            trace(EVENT_INTERRUPT_ENTRY, static_cast<uint16_t>(p.interrupt));
+        }
+
+        if (p.handler != nullptr) {
+            p.handler();
+        }
+
+        uint32_t duration = cycles() - start;
+        record(p.profile.duration, duration);
+        record(p.profile.durationHistogram, duration);
+        if (p.trace) {
+            trace(EVENT_INTERRUPT_EXIT, static_cast<uint16_t>(p.interrupt));
+        }
+    }
+
+    // Called by Core::setInterruptHandler() : if the interrupt is profiled, the new driver handler
+    // is saved in its slot and the instrumented entry stays in the vector
+    bool interruptHandlerHook(Core::Interrupt interrupt, void (*handler)()) {
+        int n = _slots[static_cast<int>(interrupt)] - 1;
+        if (n < 0) {
+            return false;
+        }
+        _profiledInterrupts[n].handler = handler;
+        return true;
+    }
+
+
+    // Tracing
+
+    // Enable the trace events. With TraceOutput::ITM, the events are sent over SWO, in NRZ (UART)
+    // mode at the given frequency : the timestamp on the stimulus port TRACE_ITM_PORT, followed by
+    // the id and data on the stimulus port TRACE_ITM_DATA_PORT. A timestamp which is not followed
+    // by a data word belongs to an event which was dropped, and must be ignored by the host.
+    void enableTrace(TraceOutput output, unsigned long swoFrequency) {
+        _traceOutput = output;
+        _traceHead = 0;
+        _traceTail = 0;
+        _traceOverflows = 0;
+
+        if (output == TraceOutput::ITM) {
+            // CSPSR (Current Parallel Port Size Register) : 1-bit port
+            (*(volatile uint32_t*) TPIU_CSPSR) = 1;
+
+            // ACPR (Asynchronous Clock Prescaler Register) : SWO frequency, based on the CPU clock
+            (*(volatile uint32_t*) TPIU_ACPR) = PM::getCPUClockFrequency() / swoFrequency - 1;
+
+            // SPPR (Selected Pin Protocol Register) : asynchronous NRZ
+            (*(volatile uint32_t*) TPIU_SPPR) = TPIU_SPPR_NRZ;
+
+            // FFCR (Formatter and Flush Control Register) : bypass the formatter
+            (*(volatile uint32_t*) TPIU_FFCR) = 1 << TPIU_FFCR_TRIGIN;
+
+            // LAR (Lock Access Register) : unlock the ITM registers
+            (*(volatile uint32_t*) ITM_LAR) = ITM_LAR_KEY;
+
+            // TCR (Trace Control Register) : enable the ITM
+            (*(volatile uint32_t*) ITM_TCR)
+                = 1 << ITM_TCR_ITMENA       // ITMENA : enable the ITM
+                | 1 << ITM_TCR_SYNCENA      // SYNCENA : send synchronization packets
+                | 1 << ITM_TCR_TRACEBUSID;  // TraceBusID : ATB ID 1
+
+            // TER (Trace Enable Register) : enable the stimulus ports
+            (*(volatile uint32_t*) ITM_TER) |= 1 << TRACE_ITM_PORT | 1 << TRACE_ITM_DATA_PORT;
+        }
+
+        _traceEnabled = true;
+    }
+
+    void disableTrace() {
+        _traceEnabled = false;
+        if (_traceOutput == TraceOutput::ITM) {
+            // TER (Trace Enable Register) : disable the stimulus ports
+            (*(volatile uint32_t*) ITM_TER) &= ~(uint32_t)(1 << TRACE_ITM_PORT | 1 << TRACE_ITM_DATA_PORT);
+        }
+    }
+
+    // Emit a trace event timestamped with the cycle counter. This can be called from any context
+    // and never waits for the output : if the ITM FIFO or the buffer is full, the event is
+    // dropped and counted in traceOverflowCounter().
+    void trace(uint16_t id, uint16_t data) {
+        if (!_traceEnabled) {
+            return;
+        }
+
+        uint32_t primask = Core::enterCriticalSection();
+        uint32_t timestamp = cycles();
+
+        if (_traceOutput == TraceOutput::ITM) {
+            // A stimulus port reads as 1 when the FIFO can accept a word. Waiting for the FIFO here
+            // would add the SWO transmission time to the traced code, with the interrupts masked :
+            // when the second word cannot be accepted, the event is dropped instead, and the host
+            // ignores the timestamp which is not followed by a data word.
+            volatile uint32_t* timestampPort = (volatile uint32_t*)(ITM_STIM0 + TRACE_ITM_PORT * 4);
+            volatile uint32_t* dataPort = (volatile uint32_t*)(ITM_STIM0 + TRACE_ITM_DATA_PORT * 4);
+            if (*timestampPort == 0) {
+                _traceOverflows++;
+            } else {
+                *timestampPort = timestamp;
+                if (*dataPort == 0) {
+                    _traceOverflows++;
+                } else {
+                    *dataPort = id | (uint32_t)data << 16;
+                }
+            }
+
+        } else {
+            if (_traceHead - _traceTail >= (uint32_t)TRACE_BUFFER_SIZE) {
+                _traceOverflows++;
+            } else {
+                TraceEvent& event = _traceBuffer[_traceHead & (TRACE_BUFFER_SIZE - 1)];
+                event.timestamp = timestamp;
+                event.id = id;
+                event.data = data;
+                _traceHead++;
+            }
+        }
+
+        Core::exitCriticalSection(primask);
+    }
+
+    // Copy up to n events from the trace buffer and return the number of events copied
+    int readTrace(TraceEvent* events, int n) {
+        int i = 0;
+        while (i < n) {
+            uint32_t primask = Core::enterCriticalSection();
+            if (_traceTail == _traceHead) {
+                Core::exitCriticalSection(primask);
+                break;
+            }
+            events[i] = _traceBuffer[_traceTail & (TRACE_BUFFER_SIZE - 1)];
+            _traceTail++;
+            Core::exitCriticalSection(primask);
+            i++;
+        }
+        return i;
+    }
+
+    // Number of trace events lost because the output was full
+    unsigned int traceOverflowCounter() {
+        return _traceOverflows;
+    }
+
+}
@@ -0,0 +1,131 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <stdint.h>
+#include "core.h"
+#include "error.h"
+
+// Profiler
+// This module measures execution times in CPU cycles with the DWT (Data Watchpoint and Trace)
+// cycle counter, which is read in a single instruction. It provides :
+// - scoped timers, which accumulate the duration of a block of code into a Stats structure ;
+// - interrupt profiling : the vector entry of a profiled interrupt is replaced by an instrumented
+//   entry which calls the driver handler and records its duration (including nested interrupts)
+//   and, when the triggering event has been marked with markRaised(), its latency ;
+// - trace events, timestamped in cycles, either streamed over ITM/SWO to a debug probe, or
+//   stored in a buffer which the application drains with readTrace() (for example to send them
+//   over USB with USBCom::write()).
+// Note that the DWT and ITM are also enabled on PA23 when a debugger is connected, which
+// prevents this pin from being used by I2C0 while the cycle counter is enabled.
+namespace Profiler {
+
+    // ITM (Instrumentation Trace Macrocell) registers
+    const uint32_t ITM_STIM0 = 0xE0000000;  // Stimulus Port Register 0
+    const uint32_t ITM_TER = 0xE0000E00;    // Trace Enable Register
+    const uint32_t ITM_TCR = 0xE0000E80;    // Trace Control Register
+    const uint32_t ITM_LAR = 0xE0000FB0;    // Lock Access Register
+
+    // TPIU (Trace Port Interface Unit) registers
+    const uint32_t TPIU_CSPSR = 0xE0040004; // Current Parallel Port Size Register
+    const uint32_t TPIU_ACPR = 0xE0040010;  // Asynchronous Clock Prescaler Register
+    const uint32_t TPIU_SPPR = 0xE00400F0;  // Selected Pin Protocol Register
+    const uint32_t TPIU_FFCR = 0xE0040304;  // Formatter and Flush Control Register
+
+    // Subregisters
+    const uint32_t ITM_TCR_ITMENA = 0;
+    const uint32_t ITM_TCR_SYNCENA = 2;
+    const uint32_t ITM_TCR_TRACEBUSID = 16;
+    const uint32_t TPIU_FFCR_TRIGIN = 8;
+
+    // Constant values
+    const uint32_t ITM_LAR_KEY = 0xC5ACCE55;
+    const uint32_t TPIU_SPPR_NRZ = 2;
+
+    const int MAX_PROFILED_INTERRUPTS = 8;
+    const int N_HISTOGRAM_BUCKETS = 16;
+    const int TRACE_BUFFER_SIZE = 128; // events, must be a power of 2
+    const int TRACE_ITM_PORT = 1;       // Timestamp of each event
+    const int TRACE_ITM_DATA_PORT = 2;  // Id and data of each event
+    const unsigned long DEFAULT_SWO_FREQUENCY = 2000000; // Hz
+
+    // Trace event identifiers from 0xFF00 are reserved for the profiler
+    const uint16_t EVENT_INTERRUPT_ENTRY = 0xFF00;
+    const uint16_t EVENT_INTERRUPT_EXIT = 0xFF01;
+
+    // Error codes
+    const Error::Code ERR_TOO_MANY_PROFILED_INTERRUPTS = 0x0001;
+
+    enum class TraceOutput {
+        BUFFER,
+        ITM,
+    };
+
+    // Accumulated durations, in cycles
+    struct Stats {
+        unsigned long count = 0;
+        uint64_t total = 0;
+        uint32_t min = 0xFFFFFFFF;
+        uint32_t max = 0;
+    };
+
+    // Bucket i counts the values between 2^(i-1) and 2^i - 1 cycles (bucket 0 counts
+    // the zeros), the last bucket also counts every larger value
+    struct Histogram {
+        unsigned long buckets[N_HISTOGRAM_BUCKETS] = {};
+    };
+
+    struct InterruptProfile {
+        Stats duration;
+        Histogram durationHistogram;
+        Histogram latencyHistogram;
+    };
+
+    // 8 bytes without padding, so that the events can be sent as is
+    struct TraceEvent {
+        uint32_t timestamp;
+        uint16_t id;
+        uint16_t data;
+    };
+
+
+    // Module API
+    void init();
+    void disable();
+    inline uint32_t cycles() { return Core::cycles(); }
+    void record(Stats& stats, uint32_t cycles);
+    void record(Histogram& histogram, uint32_t cycles);
+    void reset(Stats& stats);
+    void reset(Histogram& histogram);
+
+    // Interrupt profiling
+    bool profileInterrupt(Core::Interrupt interrupt, bool trace=false);
+    void stopProfilingInterrupt(Core::Interrupt interrupt);
+    void markRaised(Core::Interrupt interrupt);
+    const InterruptProfile* interruptProfile(Core::Interrupt interrupt);
+    void resetInterruptProfile(Core::Interrupt interrupt);
+
+    // Tracing
+    void enableTrace(TraceOutput output=TraceOutput::BUFFER, unsigned long swoFrequency=DEFAULT_SWO_FREQUENCY);
+    void disableTrace();
+    void trace(uint16_t id, uint16_t data=0);
+    int readTrace(TraceEvent* events, int n);
+    unsigned int traceOverflowCounter();
+
+    // Measure the time spent in the enclosing block :
+    //     {
+    //         Profiler::ScopedTimer timer(_filterStats);
+    //         ...
+    //     }
+    class ScopedTimer {
+    public:
+        ScopedTimer(Stats& stats) : _stats(stats), _start(cycles()) {}
+        ~ScopedTimer() { record(_stats, cycles() - _start); }
+
+    private:
+        Stats& _stats;
+        uint32_t _start;
+    };
+
+}
+
+#endif
@@ -34,7 +34,7 @@ namespace SPI {
     uint8_t _slaveRXBuffer[SLAVE_BUFFERS_SIZE];
     int _slaveTransferSize = 0;
     bool _slaveTransferFinished = false;
-    void (*_slaveTransferFinishedHandler)(int nReceivedBytes) = nullptr;
+    Callback<int> _slaveTransferFinishedHandler;
     extern uint8_t INTERRUPT_PRIORITY;
 
 
@@ -67,6 +67,16 @@ namespace SPI {
             _enabledPeripherals[3] = false;
         }
 
+        // Release the DMA channels
+        if (_rxDMAChannel > -1) {
+            DMA::freeChannel(_rxDMAChannel);
+            _rxDMAChannel = -1;
+        }
+        if (_txDMAChannel > -1) {
+            DMA::freeChannel(_txDMAChannel);
+            _txDMAChannel = -1;
+        }
+
         // MR (Mode Register) : deconfigure the interface
         (*(volatile uint32_t*)(SPI_BASE + OFFSET_MR)) = 0;
 
@@ -501,7 +511,7 @@ namespace SPI {
         return rxBufferSize;
     }
 
-    void enableSlaveTransferFinishedInterrupt(void (*handler)(int nReceivedBytes)) {
+    void enableSlaveTransferFinishedInterrupt(Callback<int> handler) {
         // Save the user handler
         _slaveTransferFinishedHandler = handler;
 
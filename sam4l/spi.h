@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include "gpio.h"
 #include "error.h"
+#include "callback.h"
 
 // Serial Peripheral Interface
 // This module allows the chip to communicate through an SPI interface,
@@ -108,7 +109,7 @@ namespace SPI {
     void slaveTransfer(const uint8_t* txBuffer=nullptr, int txBufferSize=-1);
     bool isSlaveTransferFinished();
     int slaveGetReceivedData(uint8_t* rxBuffer, int rxBufferSize);
-    void enableSlaveTransferFinishedInterrupt(void (*handler)(int nReceivedBytes));
+    void enableSlaveTransferFinishedInterrupt(Callback<int> handler);
     void disableSlaveTransferFinishedInterrupt();
 
     // Common functions
@@ -24,8 +24,8 @@ namespace TC {
 
     // Interrupts
     void enableInterrupt(Counter counter);
-    void interruptHandlerWrapper();
-    void (*_counterOverflowHandler[MAX_N_TC][N_COUNTERS_PER_TC])(Counter counter);
+    void interruptHandler(int interrupt);
+    Callback<Counter> _counterOverflowHandler[MAX_N_TC][N_COUNTERS_PER_TC];
     bool _counterOverflowHandlerEnabled[MAX_N_TC][N_COUNTERS_PER_TC];
     void (*_counterOverflowInternalHandler[MAX_N_TC][N_COUNTERS_PER_TC])(Counter counter);
     void (*_rbLoadingHandler[MAX_N_TC][N_COUNTERS_PER_TC])(Counter counter);
@@ -36,10 +36,20 @@ namespace TC {
     void (*_rcCompareInternalHandler[MAX_N_TC][N_COUNTERS_PER_TC])(Counter counter);
     volatile uint32_t _sr = 0;
 
+    // User handlers can be executed from the Core deferred work queue instead of the interrupt
+    bool _deferredHandlers = false;
+    enum class UserHandler {
+        COUNTER_OVERFLOW,
+        COUNTER_FULL,
+        EXEC_DELAYED,
+    };
+    void callUserHandler(UserHandler type, Counter counter);
+    void deferredUserHandler(uint32_t arg);
+
     // Simple counter mode
     uint32_t _counterModeMaxValue[MAX_N_TC][N_COUNTERS_PER_TC];
     uint16_t _counterModeMSB[MAX_N_TC][N_COUNTERS_PER_TC];
-    void (*_counterModeFullHandler[MAX_N_TC][N_COUNTERS_PER_TC])(Counter counter);
+    Callback<Counter> _counterModeFullHandler[MAX_N_TC][N_COUNTERS_PER_TC];
     bool _counterModeFullHandlerEnabled[MAX_N_TC][N_COUNTERS_PER_TC];
     void simpleCounterOverflowHandler(Counter counter);
     void simpleCounterRCCompareHandler(Counter counter);
@@ -54,10 +64,23 @@ namespace TC {
     void measurementRBLoadingHandler(Counter counter);
     const uint16_t MEASUREMENT_RC_TRIGGER = 0xE000;
 
+    // Input capture mode : the interrupt handler is the only writer of head and the reader
+    // is the only writer of tail, one slot is always left empty to tell a full buffer from an empty one
+    struct CaptureData {
+        Capture* buffer;
+        unsigned int size;
+        volatile unsigned int head;
+        volatile unsigned int tail;
+        volatile unsigned int lost;
+        uint16_t msb;
+    };
+    CaptureData _captureData[MAX_N_TC][N_COUNTERS_PER_TC];
+    void captureHandler(Counter counter, uint32_t sr);
+
     // Internal list of delayed callbacks to execute
     extern uint8_t INTERRUPT_PRIORITY;
     struct ExecDelayedData {
-        uint32_t handler;
+        Callback<> handler;
         int skipPeriods;
         int skipPeriodsReset;
         int rest;
@@ -65,7 +88,7 @@ namespace TC {
         bool repeat;
     };
     ExecDelayedData _execDelayedData[MAX_N_TC][N_COUNTERS_PER_TC];
-    void execDelayedHandlerWrapper();
+    void execDelayedHandler(int interrupt);
 
     // Internal functions
     inline void checkTC(Counter counter) {
@@ -83,7 +106,6 @@ namespace TC {
             memset(_pinsCLKEnabled, 0, sizeof(_pinsCLKEnabled));
             memset(_countersConfig, 0, sizeof(_countersConfig));
             memset(_counterModeMSB, 0, sizeof(_counterModeMSB));
-            memset(_counterOverflowHandler, 0, sizeof(_counterOverflowHandler));
             memset(_counterOverflowHandlerEnabled, 0, sizeof(_counterOverflowHandlerEnabled));
             memset(_counterOverflowInternalHandler, 0, sizeof(_counterOverflowInternalHandler));
             memset(_rbLoadingHandler, 0, sizeof(_rbLoadingHandler));
@@ -92,13 +114,18 @@ namespace TC {
             memset(_rcCompareHandler, 0, sizeof(_rcCompareHandler));
             memset(_rcCompareHandlerEnabled, 0, sizeof(_rcCompareHandlerEnabled));
             memset(_rcCompareInternalHandler, 0, sizeof(_rcCompareInternalHandler));
-            memset(_counterModeFullHandler, 0, sizeof(_counterModeFullHandler));
             memset(_counterModeFullHandlerEnabled, 0, sizeof(_counterModeFullHandlerEnabled));
             memset(_periodMSB, 0, sizeof(_periodMSB));
             memset(_highTimeMSB, 0, sizeof(_highTimeMSB));
             memset(_periodMSBInternal, 0, sizeof(_periodMSB));
             memset(_highTimeMSBInternal, 0, sizeof(_highTimeMSB));
-            memset(_execDelayedData, 0, sizeof(_execDelayedData));
+            for (int i = 0; i < MAX_N_TC; i++) {
+                for (int j = 0; j < N_COUNTERS_PER_TC; j++) {
+                    _counterOverflowHandler[i][j] = nullptr;
+                    _counterModeFullHandler[i][j] = nullptr;
+                    _execDelayedData[i][j] = ExecDelayedData();
+                }
+            }
             _init = true;
         }
     }
@@ -165,6 +192,7 @@ namespace TC {
         _rcCompareInternalHandler[counter.tc][counter.n] = nullptr;
         _counterModeFullHandler[counter.tc][counter.n] = nullptr;
         _counterModeFullHandlerEnabled[counter.tc][counter.n] = false;
+        _captureData[counter.tc][counter.n].buffer = nullptr;
 
         // Disable the output pins
         for (int i = 0; i < N_CHANNELS_PER_COUNTER; i++) {
@@ -253,12 +281,12 @@ namespace TC {
     }
 
     // Register an interrupt to be called when the max value of the counter has been reached
-    void enableSimpleCounterFullInterrupt(Counter counter, void (*handler)(Counter)) {
+    void enableSimpleCounterFullInterrupt(Counter counter, Callback<Counter> handler) {
         checkTC(counter);
         uint32_t REG = TC_BASE + counter.tc * TC_SIZE + counter.n * OFFSET_COUNTER_SIZE;
 
         // Save the handler and mark it as enabled
-        if (handler != nullptr) {
+        if (handler) {
             _counterModeFullHandler[counter.tc][counter.n] = handler;
         }
         _counterModeFullHandlerEnabled[counter.tc][counter.n] = true;
@@ -367,8 +395,8 @@ namespace TC {
         }
 
         // If the Counter Full interrupt has been enabled by the user, call the registered handler
-        if (_counterModeFullHandler[counter.tc][counter.n] != nullptr && _counterModeFullHandlerEnabled[counter.tc][counter.n]) {
-            _counterModeFullHandler[counter.tc][counter.n](counter);
+        if (_counterModeFullHandler[counter.tc][counter.n] && _counterModeFullHandlerEnabled[counter.tc][counter.n]) {
+            callUserHandler(UserHandler::COUNTER_FULL, counter);
         }
     }
 
@@ -683,6 +711,203 @@ namespace TC {
     }
 
 
+    // Input capture mode
+
+    // Timestamp every edge of TIOA into the given buffer. The counter runs freely : rising edges are
+    // captured in RA and falling edges in RB, and the handler extends each capture to 32 bits with the
+    // number of counter overflows. Captures which cannot be stored because the buffer is full, or which
+    // are overwritten in RA/RB before the interrupt is handled, are counted in lostCaptures().
+    // The buffer holds up to size - 1 captures, so size must be at least 2.
+    // The PDCA cannot read the TC registers, so the captures are always moved by the interrupt handler.
+    bool enableCapture(Counter counter, Capture* buffer, unsigned int size, SourceClock sourceClock, unsigned long sourceClockFrequency) {
+        checkTC(counter);
+        uint32_t REG = TC_BASE + counter.tc * TC_SIZE + counter.n * OFFSET_COUNTER_SIZE;
+
+        // Check the buffer
+        if (buffer == nullptr || size < 2) {
+            Error::happened(Error::Module::TC, ERR_INVALID_CAPTURE_BUFFER, Error::Severity::WARNING);
+            return false;
+        }
+
+        // Initialize the counter and its clock
+        initCounter(counter, sourceClock, sourceClockFrequency);
+
+        // WPMR (Write Protect Mode Register) : disable write protect
+        (*(volatile uint32_t*)(TC_BASE + counter.tc * TC_SIZE + OFFSET_WPMR))
+            = 0 << WPMR_WPEN            // WPEN : write protect disabled
+            | UNLOCK_KEY << WPMR_WPKEY; // WPKEY : write protect key
+
+        // CCR (Channel Control Register) : disable the clock
+        (*(volatile uint32_t*)(REG + OFFSET_CCR0))
+            = 1 << CCR_CLKDIS;       // CLKDIS : disable the clock
+
+        // IDR (Interrupt Disable Register) : disable the interrupts of the previous mode
+        (*(volatile uint32_t*)(REG + OFFSET_IDR0)) = 0xFFFFFFFF;
+
+        // Reset the buffer
+        CaptureData& data = _captureData[counter.tc][counter.n];
+        data.buffer = nullptr;
+        data.size = size;
+        data.head = 0;
+        data.tail = 0;
+        data.lost = 0;
+        data.msb = 0;
+
+        // CMR (Channel Mode Register) : setup the counter in Capture Mode
+        (*(volatile uint32_t*)(REG + OFFSET_CMR0))
+            =                   // TCCLKS : clock selection
+              (static_cast<int>(sourceClock) & 0b111) << CMR_TCCLKS
+            | 0 << CMR_CLKI     // CLKI : disable clock invert
+            | 0 << CMR_BURST    // BURST : disable burst mode
+            | 0 << CMR_LDBSTOP  // LDBSTOP : keep the clock running after RB load
+            | 0 << CMR_LDBDIS   // LDBDIS : keep the clock enabled after RB load
+            | 0 << CMR_ETRGEDG  // ETRGEDG : no external trigger, the counter runs freely
+            | 1 << CMR_ABETRG   // ABETRG : TIOA is the external trigger input
+            | 0 << CMR_CPCTRG   // CPCTRG : RC disabled
+            | 0 << CMR_WAVE     // WAVE : capture mode
+            | 1 << CMR_LDRA     // LDRA : load RA on rising edge of TIOA
+            | 2 << CMR_LDRB;    // LDRB : load RB on falling edge of TIOA
+
+        // WPMR (Write Protect Mode Register) : re-enable write protect
+        (*(volatile uint32_t*)(TC_BASE + counter.tc * TC_SIZE + OFFSET_WPMR))
+            = 1 << WPMR_WPEN            // WPEN : write protect enabled
+            | UNLOCK_KEY << WPMR_WPKEY; // WPKEY : write protect key
+
+        // Enable the input pin for TIOA
+        if (!_pinsEnabled[counter.tc][N_CHANNELS_PER_COUNTER * counter.n]) {
+            GPIO::enablePeripheral(PINS[counter.tc][N_CHANNELS_PER_COUNTER * counter.n]);
+            _pinsEnabled[counter.tc][N_CHANNELS_PER_COUNTER * counter.n] = true;
+        }
+
+        // SR (Status Register) : clear the pending flags before enabling the interrupts
+        (*(volatile uint32_t*)(REG + OFFSET_SR0));
+        data.buffer = buffer;
+
+        // IER (Interrupt Enable Register) : enable the Counter Overflow and the RA/RB Loading interrupts
+        enableInterrupt(counter);
+        (*(volatile uint32_t*)(REG + OFFSET_IER0))
+            = 1 << SR_COVFS     // SR_COVFS : counter overflow status
+            | 1 << SR_LDRAS     // SR_LDRAS : RA loading status
+            | 1 << SR_LDRBS;    // SR_LDRBS : RB loading status
+
+        // CCR (Channel Control Register) : enable the clock and reset the counter
+        (*(volatile uint32_t*)(REG + OFFSET_CCR0))
+            = 1 << CCR_CLKEN         // CLKEN : enable the clock
+            | 1 << CCR_SWTRG;        // SWTRG : software trigger
+
+        return true;
+    }
+
+    void disableCapture(Counter counter) {
+        checkTC(counter);
+        uint32_t REG = TC_BASE + counter.tc * TC_SIZE + counter.n * OFFSET_COUNTER_SIZE;
+
+        // IDR (Interrupt Disable Register) : disable the interrupts
+        (*(volatile uint32_t*)(REG + OFFSET_IDR0))
+            = 1 << SR_COVFS
+            | 1 << SR_LDRAS
+            | 1 << SR_LDRBS;
+
+        // CCR (Channel Control Register) : disable the clock
+        (*(volatile uint32_t*)(REG + OFFSET_CCR0))
+            = 1 << CCR_CLKDIS;       // CLKDIS : disable the clock
+
+        _captureData[counter.tc][counter.n].buffer = nullptr;
+    }
+
+    // Number of captures waiting in the buffer
+    unsigned int availableCaptures(Counter counter) {
+        const CaptureData& data = _captureData[counter.tc][counter.n];
+        if (data.buffer == nullptr) {
+            return 0;
+        }
+        unsigned int head = data.head;
+        unsigned int tail = data.tail;
+        return head >= tail ? head - tail : head + data.size - tail;
+    }
+
+    // Copy up to n captures from the buffer, oldest first, and return the number of captures copied
+    int readCaptures(Counter counter, Capture* captures, int n) {
+        CaptureData& data = _captureData[counter.tc][counter.n];
+        if (data.buffer == nullptr) {
+            return 0;
+        }
+        int i = 0;
+        unsigned int tail = data.tail;
+        while (i < n && tail != data.head) {
+            captures[i++] = data.buffer[tail];
+            tail = (tail + 1 == data.size ? 0 : tail + 1);
+        }
+        data.tail = tail;
+        return i;
+    }
+
+    // Number of captures lost since enableCapture()
+    unsigned int lostCaptures(Counter counter) {
+        return _captureData[counter.tc][counter.n].lost;
+    }
+
+    // Internal function which extends a 16-bit capture with the number of overflows. If an overflow is
+    // pending in the same status read, a small value means that the edge happened after the overflow.
+    inline uint32_t extendCapture(const CaptureData& data, uint16_t value, uint32_t sr) {
+        uint32_t msb = data.msb;
+        if ((sr & (1 << SR_COVFS)) && value < 0x8000) {
+            msb++;
+        }
+        return msb << 16 | value;
+    }
+
+    // Internal function which stores a capture in the buffer
+    inline void pushCapture(CaptureData& data, const Capture& capture) {
+        unsigned int head = data.head;
+        unsigned int next = (head + 1 == data.size ? 0 : head + 1);
+        if (next == data.tail) {
+            data.lost++;
+            return;
+        }
+        data.buffer[head] = capture;
+        data.head = next;
+    }
+
+    // Internal handler for the capture mode, called by interruptHandler() with the status register
+    void captureHandler(Counter counter, uint32_t sr) {
+        uint32_t REG = TC_BASE + counter.tc * TC_SIZE + counter.n * OFFSET_COUNTER_SIZE;
+        CaptureData& data = _captureData[counter.tc][counter.n];
+
+        Capture captures[2];
+        int n = 0;
+        if (sr & (1 << SR_LDRAS)) {
+            captures[n].time = extendCapture(data, (*(volatile uint32_t*)(REG + OFFSET_RA0)), sr);
+            captures[n].rising = true;
+            n++;
+        }
+        if (sr & (1 << SR_LDRBS)) {
+            captures[n].time = extendCapture(data, (*(volatile uint32_t*)(REG + OFFSET_RB0)), sr);
+            captures[n].rising = false;
+            n++;
+        }
+
+        // LOVRS : RA or RB has been loaded again before being read
+        if (sr & (1 << SR_LOVRS)) {
+            data.lost++;
+        }
+
+        // When both edges are pending, store them in chronological order
+        if (n == 2 && (int32_t)(captures[1].time - captures[0].time) < 0) {
+            Capture c = captures[0];
+            captures[0] = captures[1];
+            captures[1] = c;
+        }
+        for (int i = 0; i < n; i++) {
+            pushCapture(data, captures[i]);
+        }
+
+        if (sr & (1 << SR_COVFS)) {
+            data.msb++;
+        }
+    }
+
+
     // Interrupts
 
     // Enable the interrupts for the given counter at the core level
@@ -690,17 +915,17 @@ namespace TC {
         checkTC(counter);
 
         Core::Interrupt interrupt = static_cast<Core::Interrupt>(static_cast<int>(Core::Interrupt::TC00) + counter.tc * N_COUNTERS_PER_TC + counter.n);
-        Core::setInterruptHandler(interrupt, &interruptHandlerWrapper);
+        Core::setInterruptHandler<interruptHandler, MAX_N_TC * N_COUNTERS_PER_TC>(interrupt, counter.tc * N_COUNTERS_PER_TC + counter.n);
         Core::enableInterrupt(interrupt, INTERRUPT_PRIORITY);
     }
 
     // Enable the Counter Overflow interrupt on the given counter
-    void enableCounterOverflowInterrupt(Counter counter, void (*handler)(Counter)) {
+    void enableCounterOverflowInterrupt(Counter counter, Callback<Counter> handler) {
         checkTC(counter);
         uint32_t REG = TC_BASE + counter.tc * TC_SIZE + counter.n * OFFSET_COUNTER_SIZE;
 
         // Save the user handler and mark it as enabled
-        if (handler != nullptr) {
+        if (handler) {
             _counterOverflowHandler[counter.tc][counter.n] = handler;
         }
         _counterOverflowHandlerEnabled[counter.tc][counter.n] = true;
@@ -729,10 +954,48 @@ namespace TC {
         }
     }
 
-    // Internal interrupt handler wrapper
-    void interruptHandlerWrapper() {
-        // Get the channel which generated the interrupt
-        int interrupt = static_cast<int>(Core::currentInterrupt()) - static_cast<int>(Core::Interrupt::TC00);
+    // When enabled, the user handlers (counter overflow, counter full and execDelayed() callbacks) are
+    // posted to the Core deferred work queue and executed from PendSV, after every interrupt has been
+    // handled. The internal handlers still run in the interrupt, so the timings are not affected.
+    // If the deferred work queue is full, the handler is called directly from the interrupt and
+    // WARN_DEFERRED_QUEUE_FULL is reported.
+    void setDeferredHandlers(bool deferred) {
+        _deferredHandlers = deferred;
+    }
+
+    void callUserHandler(UserHandler type, Counter counter) {
+        uint32_t arg = static_cast<int>(type) << 16 | counter.tc << 8 | counter.n;
+        if (_deferredHandlers) {
+            if (Core::defer(deferredUserHandler, arg)) {
+                return;
+            }
+            Error::happened(Error::Module::TC, WARN_DEFERRED_QUEUE_FULL, Error::Severity::WARNING);
+        }
+        deferredUserHandler(arg);
+    }
+
+    void deferredUserHandler(uint32_t arg) {
+        Counter counter = {
+            .tc = static_cast<uint8_t>((arg >> 8) & 0xFF),
+            .n = static_cast<uint8_t>(arg & 0xFF)
+        };
+        UserHandler type = static_cast<UserHandler>(arg >> 16);
+        if (type == UserHandler::EXEC_DELAYED) {
+            const Callback<>& handler = _execDelayedData[counter.tc][counter.n].handler;
+            if (handler) {
+                handler();
+            }
+            return;
+        }
+        const Callback<Counter>& handler = (type == UserHandler::COUNTER_FULL ?
+                _counterModeFullHandler[counter.tc][counter.n] : _counterOverflowHandler[counter.tc][counter.n]);
+        if (handler) {
+            handler(counter);
+        }
+    }
+
+    // Internal interrupt handler of each counter, installed directly in the vector table
+    void interruptHandler(int interrupt) {
         Counter counter = {
             .tc = static_cast<uint8_t>(interrupt / N_COUNTERS_PER_TC),
             .n = static_cast<uint8_t>(interrupt % N_COUNTERS_PER_TC)
@@ -746,6 +1009,12 @@ namespace TC {
         // Get the triggered interrupts from SR and IMR (Interrupt Mask Register)
         uint32_t interrupts = _sr & (*(volatile uint32_t*)(REG + OFFSET_IMR0));
 
+        // In capture mode, the overflow and the captures must be handled together to be ordered
+        if (_captureData[counter.tc][counter.n].buffer != nullptr) {
+            captureHandler(counter, _sr);
+            return;
+        }
+
         // RC Compare
         if (interrupts & (1 << SR_CPCS)) {
             // Call the internal handler if one has been registered
@@ -767,8 +1036,8 @@ namespace TC {
             }
 
             // Call the user handler if one has been registered and enabled
-            if (_counterOverflowHandler[counter.tc][counter.n] != nullptr && _counterOverflowHandlerEnabled[counter.tc][counter.n]) {
-                _counterOverflowHandler[counter.tc][counter.n](counter);
+            if (_counterOverflowHandler[counter.tc][counter.n] && _counterOverflowHandlerEnabled[counter.tc][counter.n]) {
+                callUserHandler(UserHandler::COUNTER_OVERFLOW, counter);
             }
         }
 
@@ -957,7 +1226,7 @@ namespace TC {
     }
 
     // Call the given handler after the specified delay
-    void execDelayed(Counter counter, void (*handler)(), unsigned long delay, bool repeat, Unit unit, SourceClock sourceClock, unsigned long sourceClockFrequency) {
+    void execDelayed(Counter counter, Callback<> handler, unsigned long delay, Unit unit, bool repeat, SourceClock sourceClock, unsigned long sourceClockFrequency) {
         checkTC(counter);
         uint32_t REG = TC_BASE + counter.tc * TC_SIZE + counter.n * OFFSET_COUNTER_SIZE;
 
@@ -969,7 +1238,7 @@ namespace TC {
 
         // Set the handler
         ExecDelayedData& data = _execDelayedData[counter.tc][counter.n];
-        data.handler = (uint32_t)handler;
+        data.handler = handler;
 
         // Compute timings
         // If the requested delay is longer than a full period of the counter, compute and save the number
@@ -990,7 +1259,7 @@ namespace TC {
 
         // Enable the interrupt at the core level
         Core::Interrupt interrupt = static_cast<Core::Interrupt>(static_cast<int>(Core::Interrupt::TC00) + counter.tc * N_COUNTERS_PER_TC + counter.n);
-        Core::setInterruptHandler(interrupt, &execDelayedHandlerWrapper);
+        Core::setInterruptHandler<execDelayedHandler, MAX_N_TC * N_COUNTERS_PER_TC>(interrupt, counter.tc * N_COUNTERS_PER_TC + counter.n);
         Core::enableInterrupt(interrupt, INTERRUPT_PRIORITY);
 
         // IER (Interrupt Enable Register) : enable the CPCS (RC value reached) interrupt
@@ -1001,9 +1270,7 @@ namespace TC {
         (*(volatile uint32_t*)(REG + OFFSET_CCR0)) = 1 << CCR_SWTRG;
     }
 
-    void execDelayedHandlerWrapper() {
-        // Get the channel which generated the interrupt
-        int interrupt = static_cast<int>(Core::currentInterrupt()) - static_cast<int>(Core::Interrupt::TC00);
+    void execDelayedHandler(int interrupt) {
         int tc = interrupt / N_COUNTERS_PER_TC;
         int counter = interrupt % N_COUNTERS_PER_TC;
         uint32_t REG = TC_BASE + tc * TC_SIZE + counter * OFFSET_COUNTER_SIZE;
@@ -1028,9 +1295,11 @@ namespace TC {
             // Otherwise, if skipPeriods == 0 and rest == 0, the time has expired
 
             // Call the user handler
-            void (*handler)() = (void (*)())data.handler;
-            if (handler) {
-                handler();
+            if (data.handler) {
+                callUserHandler(UserHandler::EXEC_DELAYED, {
+                    .tc = static_cast<uint8_t>(tc),
+                    .n = static_cast<uint8_t>(counter)
+                });
             }
 
             // Repeat
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include "gpio.h"
 #include "error.h"
+#include "callback.h"
 
 // Timers/Counters
 // This module manages timers, which are counting registers that are automatically
@@ -148,6 +149,12 @@ namespace TC {
         CLK2,
     };
 
+    // Input capture event : time of the edge in counts of the source clock, extended to 32 bits
+    struct Capture {
+        uint32_t time;
+        bool rising;
+    };
+
     enum class PinFunction {
         OUT,
         CLK
@@ -175,11 +182,13 @@ namespace TC {
 
     // Error codes
     const Error::Code ERR_INVALID_TC = 0x0001;
+    const Error::Code ERR_INVALID_CAPTURE_BUFFER = 0x0002;
+    const Error::Code WARN_DEFERRED_QUEUE_FULL = 0x0003;
 
 
     // Simple counter mode
     void enableSimpleCounter(Counter counter, uint32_t maxValue=0xFFFF, SourceClock sourceClock=SourceClock::PBA_OVER_8, unsigned long sourceClockFrequency=0, bool invertClock=false, bool upDown=false);
-    void enableSimpleCounterFullInterrupt(Counter counter, void (*handler)(Counter)=nullptr);
+    void enableSimpleCounterFullInterrupt(Counter counter, Callback<Counter> handler=nullptr);
     void disableSimpleCounterFullInterrupt(Counter counter);
 
     // PWM mode
@@ -201,9 +210,17 @@ namespace TC {
     unsigned int measuredDutyCycle(Counter counter);
     bool isMeasureOverflow(Counter counter);
 
+    // Input capture mode
+    bool enableCapture(Counter counter, Capture* buffer, unsigned int size, SourceClock sourceClock=SourceClock::PBA_OVER_8, unsigned long sourceClockFrequency=0);
+    void disableCapture(Counter counter);
+    unsigned int availableCaptures(Counter counter);
+    int readCaptures(Counter counter, Capture* captures, int n);
+    unsigned int lostCaptures(Counter counter);
+
     // Interrupts
-    void enableCounterOverflowInterrupt(Counter counter, void (*handler)(Counter)=nullptr);
+    void enableCounterOverflowInterrupt(Counter counter, Callback<Counter> handler=nullptr);
     void disableCounterOverflowInterrupt(Counter counter);
+    void setDeferredHandlers(bool deferred);
 
     // Low-level counter functions
     bool setRX(Channel channel, unsigned int rx);
@@ -216,7 +233,7 @@ namespace TC {
 
     // Timing functions
     void wait(Counter counter, unsigned long delay, Unit unit=Unit::MILLISECONDS, SourceClock sourceClock=SourceClock::PBA_OVER_8, unsigned long sourceClockFrequency=0);
-    void execDelayed(Counter counter, void (*handler)(), unsigned long delay, Unit unit=Unit::MILLISECONDS, bool repeat=false, SourceClock sourceClock=SourceClock::PBA_OVER_8, unsigned long sourceClockFrequency=0);
+    void execDelayed(Counter counter, Callback<> handler, unsigned long delay, Unit unit=Unit::MILLISECONDS, bool repeat=false, SourceClock sourceClock=SourceClock::PBA_OVER_8, unsigned long sourceClockFrequency=0);
 
     // Functions common to all modes
     void start(Counter counter);
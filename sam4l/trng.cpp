@@ -6,7 +6,7 @@ namespace TRNG {
 
     // Interrupt handler
     extern uint8_t INTERRUPT_PRIORITY;
-    uint32_t _dataReadyHandler = 0;
+    Callback<uint32_t> _dataReadyHandler;
     void interruptHandlerWrapper();
 
     void enable() {
@@ -32,9 +32,9 @@ namespace TRNG {
         return (*(volatile uint32_t*)(BASE + OFFSET_ODATA));
     }
 
-    void enableInterrupt(void (*handler)(uint32_t)) {
+    void enableInterrupt(Callback<uint32_t> handler) {
         // Save the user handler
-        _dataReadyHandler = (uint32_t)handler;
+        _dataReadyHandler = handler;
 
         // IER (Interrupt Enable Register) : enable the Data Ready interrupt (this is the
         // only interrupt available)
@@ -57,9 +57,8 @@ namespace TRNG {
 
     void interruptHandlerWrapper() {
         // Call the user handler
-        void (*handler)(uint32_t) = (void (*)(uint32_t))_dataReadyHandler;
-        if (handler != nullptr) {
-            handler(get());
+        if (_dataReadyHandler) {
+            _dataReadyHandler(get());
         }
 
         // Clear the interrupt by reading ISR
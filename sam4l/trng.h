@@ -2,6 +2,7 @@
 #define _TRNG_H_
 
 #include <stdint.h>
+#include "callback.h"
 
 // True Random Number Generator
 // This module provides 32-bit highly random numbers
@@ -28,7 +29,7 @@ namespace TRNG {
     void enable();
     bool available();
     uint32_t get();
-    void enableInterrupt(void (*handler)(uint32_t));
+    void enableInterrupt(Callback<uint32_t> handler);
     void disableInterrupt();
 
 }
@@ -10,16 +10,16 @@ namespace USART {
     bool _initialized = false;
 
     // Internal functions
-    void rxBufferFullHandler();
+    void rxBufferFullHandler(void* context);
 
     // Clocks
     const int PM_CLK[] = {PM::CLK_USART0, PM::CLK_USART1, PM::CLK_USART2, PM::CLK_USART3};
 
     // Interrupt handlers
     extern uint8_t INTERRUPT_PRIORITY;
-    uint32_t _interruptHandlers[N_PORTS][N_INTERRUPTS];
+    Callback<> _interruptHandlers[N_PORTS][N_INTERRUPTS];
     const int _interruptBits[N_INTERRUPTS] = {CSR_RXRDY, CSR_TXRDY, CSR_OVRE, CSR_PARE};
-    void interruptHandlerWrapper();
+    void interruptHandler(int port);
 
     // Package-dependant, defined in pins_sam4l_XX.cpp
     // Can be modified using setPin()
@@ -43,8 +43,6 @@ namespace USART {
 #endif
     struct USART* _ports[N_PORTS];
 
-    int _rxDMAChannelsToPorts[DMA::N_CHANNELS_MAX];
-
     bool _portsEnabled[N_PORTS] = {false, false, false, false};
 
 
@@ -149,12 +147,13 @@ namespace USART {
         (*(volatile uint32_t*)(REG_BASE + OFFSET_WPMR)) = WPMR_KEY | WPMR_ENABLE;
 
         // Set up the DMA channels and related interrupts
-        p->rxDMAChannel = DMA::setupChannel(p->rxDMAChannel, static_cast<DMA::Device>(static_cast<int>(DMA::Device::USART0_RX) + static_cast<int>(port)), DMA::Size::BYTE);
+        // The RX channel is latency-critical : request a high-priority channel so that incoming bytes
+        // are not delayed by other transfers
+        p->rxDMAChannel = DMA::setupChannel(p->rxDMAChannel, static_cast<DMA::Device>(static_cast<int>(DMA::Device::USART0_RX) + static_cast<int>(port)), DMA::Size::BYTE, 0x00000000, 0, false, DMA::Priority::HIGH);
         p->txDMAChannel = DMA::setupChannel(p->txDMAChannel, static_cast<DMA::Device>(static_cast<int>(DMA::Device::USART0_TX) + static_cast<int>(port)), DMA::Size::BYTE);
-        _rxDMAChannelsToPorts[p->rxDMAChannel] = static_cast<int>(port);
         DMA::startChannel(p->rxDMAChannel, (uint32_t)(p->rxBuffer), BUFFER_SIZE);
         //DMA::reloadChannel(p->rxDMAChannel, (uint32_t)(p->rxBuffer), BUFFER_SIZE);
-        DMA::enableInterrupt(p->rxDMAChannel, &rxBufferFullHandler, DMA::Interrupt::TRANSFER_FINISHED);
+        DMA::enableInterrupt(p->rxDMAChannel, {rxBufferFullHandler, p}, DMA::Interrupt::TRANSFER_FINISHED);
 
         _portsEnabled[static_cast<int>(port)] = true;
     }
@@ -173,9 +172,11 @@ namespace USART {
             return;
         }
 
-        // Disable the DMA channels
-        DMA::stopChannel(p->rxDMAChannel);
-        DMA::stopChannel(p->txDMAChannel);
+        // Release the DMA channels
+        DMA::freeChannel(p->rxDMAChannel);
+        DMA::freeChannel(p->txDMAChannel);
+        p->rxDMAChannel = -1;
+        p->txDMAChannel = -1;
 
         // WPMR (Write Protect Mode Register) : disable the Write Protect
         (*(volatile uint32_t*)(REG_BASE + OFFSET_WPMR)) = WPMR_KEY | WPMR_DISABLE;
@@ -200,11 +201,11 @@ namespace USART {
         }
     }
 
-    void enableInterrupt(Port port, void (*handler)(), Interrupt interrupt) {
+    void enableInterrupt(Port port, Callback<> handler, Interrupt interrupt) {
         const uint32_t REG_BASE = USART_BASE + static_cast<int>(port) * USART_REG_SIZE;
 
         // Save the user handler
-        _interruptHandlers[static_cast<int>(port)][static_cast<int>(interrupt)] = (uint32_t)handler;
+        _interruptHandlers[static_cast<int>(port)][static_cast<int>(interrupt)] = handler;
 
         // IER (Interrupt Enable Register) : enable the requested interrupt
         (*(volatile uint32_t*)(REG_BASE + OFFSET_IER))
@@ -212,21 +213,20 @@ namespace USART {
 
         // Enable the interrupt in the NVIC
         Core::Interrupt interruptChannel = static_cast<Core::Interrupt>(static_cast<int>(Core::Interrupt::USART0) + static_cast<int>(port));
-        Core::setInterruptHandler(interruptChannel, interruptHandlerWrapper);
+        Core::setInterruptHandler<interruptHandler, N_PORTS>(interruptChannel, static_cast<int>(port));
         Core::enableInterrupt(interruptChannel, INTERRUPT_PRIORITY);
     }
 
-    void interruptHandlerWrapper() {
-        // Get the port number through the current interrupt number
-        int port = static_cast<int>(Core::currentInterrupt()) - static_cast<int>(Core::Interrupt::USART0);
+    // Interrupt handler of each port, installed directly in the vector table
+    void interruptHandler(int port) {
         const uint32_t REG_BASE = USART_BASE + port * USART_REG_SIZE;
 
         // Call the user handler of every interrupt that is enabled and pending
         for (int i = 0; i < N_INTERRUPTS; i++) {
             if ((*(volatile uint32_t*)(REG_BASE + OFFSET_IMR)) & (1 << _interruptBits[i]) // Interrupt is enabled
                     && (*(volatile uint32_t*)(REG_BASE + OFFSET_CSR)) & (1 << _interruptBits[i])) { // Interrupt is pending
-                void (*handler)() = (void (*)())_interruptHandlers[port][i];
-                if (handler != nullptr) {
+                const Callback<>& handler = _interruptHandlers[port][i];
+                if (handler) {
                     handler();
                 }
             }
@@ -237,14 +237,9 @@ namespace USART {
             = 1 << CR_RSTSTA; // Reset status bits
     }
 
-    void rxBufferFullHandler() {
-        // Get the port that provoqued this interrupt
-        int channel = static_cast<int>(Core::currentInterrupt()) - static_cast<int>(Core::Interrupt::DMA0);
-        int portNumber = _rxDMAChannelsToPorts[channel];
-        struct USART* p = _ports[portNumber];
-        if (p == nullptr) {
-            return;
-        }
+    void rxBufferFullHandler(void* context) {
+        // The context is the port that provoqued this interrupt
+        struct USART* p = (struct USART*)context;
 
         // Reload the DMA channel
         int length = 0;
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include "gpio.h"
+#include "callback.h"
 
 // Universal Synchronous Asynchronous Receiver Transmitter
 // This module allows the chip to communicate on an RS232 link
@@ -150,7 +151,7 @@ namespace USART {
     // Module API
     void enable(Port port, unsigned long baudrate, bool hardwareFlowControl=false, CharLength charLength=CharLength::CHAR8, Parity parity=Parity::NONE, StopBit stopBit=StopBit::STOP1);
     void disable(Port port);
-    void enableInterrupt(Port port, void (*handler)(), Interrupt interrupt);
+    void enableInterrupt(Port port, Callback<> handler, Interrupt interrupt);
     int available(Port port);
     bool contains(Port port, char byte);
     char peek(Port port);
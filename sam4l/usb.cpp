@@ -136,10 +136,28 @@ namespace USB {
     extern uint8_t INTERRUPT_PRIORITY;
 
     // User handlers
-    void (*_connectedHandler)() = nullptr;
-    void (*_disconnectedHandler)() = nullptr;
-    void (*_startOfFrameHandler)() = nullptr;
+    Callback<> _connectedHandler;
+    Callback<> _disconnectedHandler;
+    Callback<> _startOfFrameHandler;
     int (*_controlHandler)(SetupPacket &_lastSetupPacket, uint8_t* data, int size) = nullptr;
+    bool _deferredHandlers = false;
+    enum class UserHandler {
+        CONNECTED,
+        DISCONNECTED,
+        START_OF_FRAME,
+    };
+    void callUserHandler(UserHandler type);
+    void deferredUserHandler(uint32_t arg);
+
+    // Deferred control requests : EP0 is kept busy (NAKing the host) until the control handler has
+    // been called from PendSV. The sequence number identifies the SETUP packet the work item answers,
+    // in order to drop the work item if the host has sent a new SETUP packet in the meantime.
+    const int CONTROL_PENDING = -1;
+    bool _deferredControl = false;
+    volatile uint32_t _setupSequence = 0;
+    bool deferControlHandler(void (*work)(uint32_t));
+    void deferredControlIN(uint32_t sequence);
+    void deferredControlOUT(uint32_t sequence);
 
 
 
@@ -338,9 +356,7 @@ namespace USB {
                 |= 1 << USBCON_FRZCLK;   // FRZCLK : freeze input clocks
 
             // Call user handler
-            if (_disconnectedHandler != nullptr) {
-                _disconnectedHandler();
-            }
+            callUserHandler(UserHandler::DISCONNECTED);
 
             // Since clocks are frozen, don't do anything more
             return;
@@ -370,9 +386,7 @@ namespace USB {
                 = 1 << UDINT_SUSP;
 
             // Call user handler
-            if (_connectedHandler != nullptr) {
-                _connectedHandler();
-            }
+            callUserHandler(UserHandler::CONNECTED);
         }
 
         // End of reset
@@ -410,9 +424,7 @@ namespace USB {
                 = 1 << UDINT_SOF;
 
             // Call user handler
-            if (_startOfFrameHandler != nullptr) {
-                _startOfFrameHandler();
-            }
+            callUserHandler(UserHandler::START_OF_FRAME);
         }
 
         // Endpoints
@@ -475,6 +487,11 @@ namespace USB {
                     if (ep->handlers[static_cast<int>(EPHandlerType::IN)] != nullptr) {
                         bytesToSend = ep->handlers[static_cast<int>(EPHandlerType::IN)](0);
                     }
+
+                    // The answer of a deferred control request will be sent by the work item
+                    if (bytesToSend == CONTROL_PENDING) {
+                        continue;
+                    }
                     _epRAMDescriptors[i * EP_DESCRIPTOR_SIZE + EP_PCKSIZE] = (1 << PCKSIZE_AUTO_ZLP) | (bytesToSend & PCKSIZE_BYTE_COUNT_MASK);
                     // Multi-packet mode is automatically enabled if BYTE_COUNT (ie bytesToSend) is larger than 
                     // the endpoint size (UECFG.EPSIZE)
@@ -512,8 +529,10 @@ namespace USB {
             .handled = false
         };
 
-        // Kill any pending IN transfer
+        // Kill any pending IN transfer, and drop any deferred control request : the host has given up on it
         abortINTransfer(0);
+        _setupSequence = _setupSequence + 1;
+        setEndpointReady(0);
 
         // If this is an IN or No Data transfer
         if (_lastSetupPacket.direction == EPDir::IN || _lastSetupPacket.wLength == 0) {
@@ -767,6 +786,10 @@ namespace USB {
                         disableINInterrupt(0);
 
                         if (_lastSetupPacket.direction == EPDir::IN || _lastSetupPacket.wLength == 0) {
+                            // Keep EP0 NAKing the host until the handler has been called from PendSV
+                            if (_deferredControl && deferControlHandler(deferredControlIN)) {
+                                return CONTROL_PENDING;
+                            }
                             int bytesToSend = _controlHandler(_lastSetupPacket, _bankEP0, min(_lastSetupPacket.wLength, BANK_EP0_SIZE));
                             return min(_lastSetupPacket.wLength, bytesToSend);
                         }
@@ -801,6 +824,11 @@ namespace USB {
         } else {
             // This is an OUT packet containing data
             if (_controlHandler != nullptr) {
+                // The bank is protected by keeping EP0 busy until the handler has been called from PendSV,
+                // which will then enable the IN interrupt to ACK the data
+                if (_deferredControl && deferControlHandler(deferredControlOUT)) {
+                    return 0;
+                }
                 int size = _epRAMDescriptors[EP_N * EP_DESCRIPTOR_SIZE + EP_PCKSIZE] & PCKSIZE_BYTE_COUNT_MASK;
                 _controlHandler(_lastSetupPacket, _bankEP0, min(size, BANK_EP0_SIZE));
             }
@@ -884,15 +912,15 @@ namespace USB {
     }
 
     // User handlers
-    void setConnectedHandler(void (*handler)()) {
+    void setConnectedHandler(Callback<> handler) {
         _connectedHandler = handler;
     }
 
-    void setDisconnectedHandler(void (*handler)()) {
+    void setDisconnectedHandler(Callback<> handler) {
         _disconnectedHandler = handler;
     }
 
-    void setStartOfFrameHandler(void (*handler)()) {
+    void setStartOfFrameHandler(Callback<> handler) {
         _startOfFrameHandler = handler;
     }
 
@@ -900,6 +928,89 @@ namespace USB {
         _controlHandler = handler;
     }
 
+    // When enabled, the connected, disconnected and start of frame handlers are posted to the Core
+    // deferred work queue and executed from PendSV, instead of being called from the USB interrupt.
+    // With deferControl, the control handler is also called from PendSV : EP0 is marked as busy
+    // and NAKs the host, which retries, until the answer is ready. This keeps a slow control handler
+    // from delaying the interrupts of a lower priority than the USB, such as DMA reloads. The host
+    // gives up on a control request after about 5 seconds. The endpoint handlers are always called
+    // from the interrupt, since their return value is needed to answer the host.
+    // If the deferred work queue is full, the handlers are called directly from the interrupt and
+    // WARN_DEFERRED_QUEUE_FULL is reported.
+    void setDeferredHandlers(bool deferred, bool deferControl) {
+        _deferredHandlers = deferred;
+        _deferredControl = deferControl;
+    }
+
+    void callUserHandler(UserHandler type) {
+        uint32_t arg = static_cast<int>(type);
+        if (_deferredHandlers) {
+            if (Core::defer(deferredUserHandler, arg)) {
+                return;
+            }
+            Error::happened(Error::Module::USB, WARN_DEFERRED_QUEUE_FULL, Error::Severity::WARNING);
+        }
+        deferredUserHandler(arg);
+    }
+
+    void deferredUserHandler(uint32_t arg) {
+        UserHandler type = static_cast<UserHandler>(arg);
+        const Callback<>& handler = (type == UserHandler::CONNECTED ? _connectedHandler
+                : type == UserHandler::DISCONNECTED ? _disconnectedHandler : _startOfFrameHandler);
+        if (handler) {
+            handler();
+        }
+    }
+
+    // Internal function which marks EP0 as busy and posts the control handler to the deferred work queue
+    bool deferControlHandler(void (*work)(uint32_t)) {
+        setEndpointBusy(0);
+        if (Core::defer(work, _setupSequence)) {
+            return true;
+        }
+        setEndpointReady(0);
+        Error::happened(Error::Module::USB, WARN_DEFERRED_QUEUE_FULL, Error::Severity::WARNING);
+        return false;
+    }
+
+    // Answer an IN or No Data control request from PendSV, then let EP0 answer the host
+    void deferredControlIN(uint32_t sequence) {
+        const int EP_N = 0; // Endpoint number : 0 in this function
+        if (sequence != _setupSequence) {
+            return;
+        }
+        int bytesToSend = _controlHandler(_lastSetupPacket, _bankEP0, min(_lastSetupPacket.wLength, BANK_EP0_SIZE));
+        bytesToSend = min(_lastSetupPacket.wLength, bytesToSend);
+
+        uint32_t primask = Core::enterCriticalSection();
+        if (sequence == _setupSequence) {
+            _epRAMDescriptors[EP_N * EP_DESCRIPTOR_SIZE + EP_PCKSIZE] = (1 << PCKSIZE_AUTO_ZLP) | (bytesToSend & PCKSIZE_BYTE_COUNT_MASK);
+
+            // Clear TXINI to send the packet, which has been held since the IN interrupt
+            (*(volatile uint32_t*)(USB_BASE + OFFSET_UESTA0CLR))
+                = 1 << UESTA_TXINI;
+            setEndpointReady(0);
+        }
+        Core::exitCriticalSection(primask);
+    }
+
+    // Process the data of an OUT control request from PendSV, then enable the IN interrupt to ACK it
+    void deferredControlOUT(uint32_t sequence) {
+        const int EP_N = 0; // Endpoint number : 0 in this function
+        if (sequence != _setupSequence) {
+            return;
+        }
+        int size = _epRAMDescriptors[EP_N * EP_DESCRIPTOR_SIZE + EP_PCKSIZE] & PCKSIZE_BYTE_COUNT_MASK;
+        _controlHandler(_lastSetupPacket, _bankEP0, min(size, BANK_EP0_SIZE));
+
+        uint32_t primask = Core::enterCriticalSection();
+        if (sequence == _setupSequence) {
+            enableINInterrupt(0);
+            setEndpointReady(0);
+        }
+        Core::exitCriticalSection(primask);
+    }
+
 
     // Misc functions
     void remoteWakeup() {
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include "gpio.h"
+#include "callback.h"
 
 // This module allows the chip to communicate on an USB
 // bus, either as Device or Host. Only device mode is currently
@@ -138,6 +139,7 @@ namespace USB {
 
     // Error codes
     const Error::Code ERR_CLOCK_NOT_USABLE = 0x0001;
+    const Error::Code WARN_DEFERRED_QUEUE_FULL = 0x0002;
 
 
     // USB Device states
@@ -361,10 +363,11 @@ namespace USB {
     void initDevice(uint16_t vendorId=DEFAULT_VENDOR_ID, uint16_t productId=DEFAULT_PRODUCT_ID, uint16_t deviceRevision=DEFAULT_DEVICE_REVISION);
     void setStringDescriptor(StringDescriptors descriptor, const char* string, int size);
     Endpoint newEndpoint(EPType type, EPDir direction, EPBanks nBanks, EPSize size, uint8_t* bank0, uint8_t* bank1=nullptr);
-    void setConnectedHandler(void (*handler)());
-    void setDisconnectedHandler(void (*handler)());
-    void setStartOfFrameHandler(void (*handler)());
+    void setConnectedHandler(Callback<> handler);
+    void setDisconnectedHandler(Callback<> handler);
+    void setStartOfFrameHandler(Callback<> handler);
     void setControlHandler(int (*handler)(SetupPacket &lastSetupPacket, uint8_t* data, int size));
+    void setDeferredHandlers(bool deferred, bool deferControl=false);
     void setEndpointHandler(Endpoint endpointNumber, EPHandlerType handlerType, int (*handler)(int));
     void setEndpointBusy(Endpoint endpointNumber=0);
     void setEndpointReady(Endpoint endpointNumber=0);
@@ -7,13 +7,13 @@ namespace WDT {
 
     // Watchdog interrupt
     extern uint8_t INTERRUPT_PRIORITY;
-    void (*_interruptHandler)() = nullptr;
+    Callback<> _interruptHandler;
     void interruptHandlerWrapper();
 
     // Clock source
     bool _useOSC32K = false;
 
-    void enable(unsigned int timeout, Unit unit, void (*timeoutHandler)(), unsigned int windowStart, bool useOSC32K) {
+    void enable(unsigned int timeout, Unit unit, Callback<> timeoutHandler, unsigned int windowStart, bool useOSC32K) {
         // If the WDT is already enabled, disable it first
         if (isEnabled()) {
             disable();
@@ -21,7 +21,7 @@ namespace WDT {
 
         // Interrupt mode
         bool interruptMode = false;
-        if (timeoutHandler != nullptr) {
+        if (timeoutHandler) {
             interruptMode = true;
             _interruptHandler = timeoutHandler;
             // Actual interrupt enabling is done at the end if the function, after the WDT is enabled
@@ -198,7 +198,7 @@ namespace WDT {
 
     void interruptHandlerWrapper() {
         // Call the user interrupt handler
-        if (_interruptHandler != nullptr) {
+        if (_interruptHandler) {
             _interruptHandler();
         }
 
@@ -2,6 +2,7 @@
 #define _WDT_H_
 
 #include <stdint.h>
+#include "callback.h"
 
 // Watchdog Timer
 // This module is able to automatically reset the chip after a
@@ -57,7 +58,7 @@ namespace WDT {
     };
 
     // Module API
-    void enable(unsigned int timeout, Unit unit=Unit::MILLISECONDS, void (*timeoutHandler)()=nullptr, unsigned int windowStart=0, bool useOSC32K=true);
+    void enable(unsigned int timeout, Unit unit=Unit::MILLISECONDS, Callback<> timeoutHandler=nullptr, unsigned int windowStart=0, bool useOSC32K=true);
     void disable();
     bool isEnabled();
     void clear();
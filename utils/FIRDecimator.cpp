@@ -0,0 +1,85 @@
+#include "FIRDecimator.h"
+#include <string.h>
+
+// Load two consecutive 16-bit values with a single word access. The Cortex-M4 supports
+// unaligned LDR, which lets the window slide one sample at a time.
+static inline uint32_t read2(const int16_t* p) {
+    uint32_t value;
+    memcpy(&value, p, 4);
+    return value;
+}
+
+// Constructor : must be passed the coefficients (which are not copied) and the buffer
+// used to store the history, which must be able to contain 2 * taps samples
+FIRDecimator::FIRDecimator(const int16_t* coefficients, unsigned int taps, int16_t* delayLine, unsigned int decimation) {
+    _coefficients = coefficients;
+    _taps = taps;
+    _delayLine = delayLine;
+    _decimation = decimation > 0 ? decimation : 1;
+    reset();
+}
+
+// Filter n input samples and return the number of samples written to output.
+// The output can be the same buffer as the input.
+int FIRDecimator::process(const uint16_t* input, uint16_t* output, int n) {
+    const unsigned int taps = _taps;
+    const int16_t* h = _coefficients;
+    int nOutput = 0;
+
+    for (int i = 0; i < n; i++) {
+        // Each sample is written twice in the delay line, so that the last taps samples are
+        // always available as a contiguous window starting at the cursor, from the oldest
+        // to the newest
+        int16_t sample = input[i];
+        _delayLine[_cursor] = sample;
+        _delayLine[_cursor + taps] = sample;
+        _cursor++;
+        if (_cursor == taps) {
+            _cursor = 0;
+        }
+
+        // Output one sample every _decimation inputs
+        _phase++;
+        if (_phase < _decimation) {
+            continue;
+        }
+        _phase = 0;
+
+        // y = sum(h[k] * x[n - k]) : the window w is in chronological order, so w[k] is
+        // multiplied by h[taps - 1 - k]. SMLALDX crosses the halfwords of its operands,
+        // which matches the pair (w[k], w[k + 1]) with the pair (h[taps - 2 - k], h[taps - 1 - k]).
+        const int16_t* w = _delayLine + _cursor;
+        int64_t acc = 1 << 14; // Rounding
+        unsigned int k = 0;
+        for (; k + 1 < taps; k += 2) {
+            __asm__ (
+                "smlaldx %Q[acc], %R[acc], %[w], %[h] \n\t"
+                : [acc] "+r" (acc)
+                : [w] "r" (read2(w + k)), [h] "r" (read2(h + taps - 2 - k))
+            );
+        }
+        if (k < taps) {
+            acc += w[k] * h[0];
+        }
+
+        // Convert back from Q15 and saturate
+        acc >>= 15;
+        if (acc < 0) {
+            acc = 0;
+        } else if (acc > 0xFFFF) {
+            acc = 0xFFFF;
+        }
+        output[nOutput++] = acc;
+    }
+
+    return nOutput;
+}
+
+// Clear the history
+void FIRDecimator::reset() {
+    for (unsigned int i = 0; i < 2 * _taps; i++) {
+        _delayLine[i] = 0;
+    }
+    _cursor = 0;
+    _phase = 0;
+}
@@ -0,0 +1,34 @@
+#ifndef _FIR_DECIMATOR_H_
+#define _FIR_DECIMATOR_H_
+
+#include <stdint.h>
+
+// This class applies a FIR filter to a stream of samples, for example the buffers received
+// from ADC::startAcquisition(), and optionally decimates the result. The coefficients are
+// given in Q15 format (32767 being almost 1.0). Only the samples which are kept after the
+// decimation are computed, and the multiply-accumulates use the dual 16-bit SMLALDX
+// instruction of the Cortex-M4 to process two taps per cycle.
+class FIRDecimator {
+private:
+    const int16_t* _coefficients = nullptr;
+    int16_t* _delayLine = nullptr;
+    unsigned int _taps = 0;
+    unsigned int _decimation = 1;
+    unsigned int _cursor = 0;
+    unsigned int _phase = 0;
+
+public:
+    // Constructor : must be passed the coefficients (which are not copied) and the buffer
+    // used to store the history, which must be able to contain 2 * taps samples
+    FIRDecimator(const int16_t* coefficients, unsigned int taps, int16_t* delayLine, unsigned int decimation=1);
+
+    // Filter n input samples and return the number of samples written to output.
+    // The output can be the same buffer as the input.
+    int process(const uint16_t* input, uint16_t* output, int n);
+
+    // Clear the history
+    void reset();
+
+};
+
+#endif
@@ -0,0 +1,236 @@
+#include "I2CPoller.h"
+
+namespace I2CPoller {
+
+    struct Poll {
+        I2C::Port port;
+        uint8_t address;
+        uint8_t reg;
+        int size;
+        bool enabled;
+        unsigned long periodTicks;
+        unsigned long countdown;
+        volatile bool pending;
+        uint8_t data[2][MAX_DATA_SIZE];
+        volatile uint8_t front;
+        volatile Core::Time timestamp;
+        volatile unsigned int nSamples;
+        volatile unsigned int nErrors;
+        volatile unsigned int nOverruns;
+    };
+
+    // List of polls
+    Poll _polls[MAX_POLLS];
+    int _nPolls = 0;
+
+    // State of each bus : the poll currently being transferred, if any, and the
+    // round-robin cursor used to pick the next pending poll
+    int _currentPoll[I2C::N_PORTS_M] = {-1, -1, -1, -1};
+    int _cursor[I2C::N_PORTS_M] = {0, 0, 0, 0};
+
+    TC::Counter _counter;
+    unsigned long _tickPeriod = 0;
+    bool _started = false;
+
+    void tick();
+    void transferFinished(I2C::Port port, bool acked);
+
+    // Register a new poll and return its index, or -1 if the table is full.
+    // The period is given in milliseconds and is rounded to a multiple of the tick period.
+    int add(I2C::Port port, uint8_t address, uint8_t reg, int size, unsigned long period) {
+        if (_nPolls == MAX_POLLS || size <= 0 || size > MAX_DATA_SIZE) {
+            return -1;
+        }
+
+        Poll& p = _polls[_nPolls];
+        p.port = port;
+        p.address = address;
+        p.reg = reg;
+        p.size = size;
+        p.enabled = true;
+        p.periodTicks = period;
+        p.countdown = 1;
+        p.pending = false;
+        p.front = 0;
+        p.timestamp = 0;
+        p.nSamples = 0;
+        p.nErrors = 0;
+        p.nOverruns = 0;
+        for (int i = 0; i < MAX_DATA_SIZE; i++) {
+            p.data[0][i] = 0;
+            p.data[1][i] = 0;
+        }
+
+        // If the scheduler is already running, convert the period to ticks now
+        if (_started) {
+            p.periodTicks = (period + _tickPeriod - 1) / _tickPeriod;
+            if (p.periodTicks == 0) {
+                p.periodTicks = 1;
+            }
+        }
+
+        return _nPolls++;
+    }
+
+    void setEnabled(int poll, bool enabled) {
+        if (poll < 0 || poll >= _nPolls) {
+            return;
+        }
+        _polls[poll].enabled = enabled;
+        _polls[poll].countdown = 1;
+    }
+
+    // Start the scheduler, using the given TC counter to generate a tick every tickPeriod milliseconds.
+    // The I2C ports used by the polls must already be enabled in master mode.
+    void start(TC::Counter counter, unsigned long tickPeriod) {
+        if (tickPeriod == 0) {
+            tickPeriod = 1;
+        }
+
+        // Convert the periods from milliseconds to ticks
+        if (!_started) {
+            for (int i = 0; i < _nPolls; i++) {
+                Poll& p = _polls[i];
+                p.periodTicks = (p.periodTicks + tickPeriod - 1) / tickPeriod;
+                if (p.periodTicks == 0) {
+                    p.periodTicks = 1;
+                }
+            }
+        }
+
+        _counter = counter;
+        _tickPeriod = tickPeriod;
+        _started = true;
+        TC::execDelayed(counter, tick, tickPeriod, TC::Unit::MILLISECONDS, true);
+    }
+
+    // Stop the tick. Transfers that are currently running will complete normally.
+    void stop() {
+        if (_started) {
+            TC::stop(_counter);
+        }
+    }
+
+    // Start the next pending poll on the given bus, if the bus is free
+    void dispatch(int bus) {
+        int next = -1;
+
+        // Select the next poll with interrupts disabled, since this function is called both
+        // from the tick and from the I2C transfer-finished interrupts
+        Core::disableInterrupts();
+        if (_currentPoll[bus] == -1) {
+            for (int i = 0; i < _nPolls; i++) {
+                int n = (_cursor[bus] + i) % _nPolls;
+                if (_polls[n].pending && static_cast<int>(_polls[n].port) == bus) {
+                    _polls[n].pending = false;
+                    _currentPoll[bus] = n;
+                    _cursor[bus] = (n + 1) % _nPolls;
+                    next = n;
+                    break;
+                }
+            }
+        }
+        Core::enableInterrupts();
+
+        // Start the transfer into the back buffer
+        if (next >= 0) {
+            Poll& p = _polls[next];
+            if (!I2C::writeReadAsync(p.port, p.address, &p.reg, 1, p.data[!p.front], p.size, transferFinished)) {
+                p.nErrors++;
+                _currentPoll[bus] = -1;
+            }
+        }
+    }
+
+    void tick() {
+        // Mark the polls which are due as pending
+        for (int i = 0; i < _nPolls; i++) {
+            Poll& p = _polls[i];
+            if (!p.enabled) {
+                continue;
+            }
+            p.countdown--;
+            if (p.countdown == 0) {
+                p.countdown = p.periodTicks;
+                if (p.pending || _currentPoll[static_cast<int>(p.port)] == i) {
+                    // The previous sample has not been read yet : the bus is too slow for this rate
+                    p.nOverruns++;
+                } else {
+                    p.pending = true;
+                }
+            }
+        }
+
+        // Start a transfer on every idle bus
+        for (int i = 0; i < I2C::N_PORTS_M; i++) {
+            dispatch(i);
+        }
+    }
+
+    void transferFinished(I2C::Port port, bool acked) {
+        int bus = static_cast<int>(port);
+        int n = _currentPoll[bus];
+        if (n >= 0) {
+            Poll& p = _polls[n];
+            if (acked) {
+                // Swap the buffers to publish the new sample
+                p.front = !p.front;
+                p.timestamp = Core::time();
+                p.nSamples++;
+            } else {
+                p.nErrors++;
+            }
+        }
+
+        // The bus is free : chain the next pending poll immediately
+        _currentPoll[bus] = -1;
+        dispatch(bus);
+    }
+
+    // Copy the latest sample of the given poll into the user buffer (which must be at least
+    // as large as the size given to add()) and return true if at least one sample was received
+    bool get(int poll, uint8_t* buffer, Core::Time* timestamp) {
+        if (poll < 0 || poll >= _nPolls) {
+            return false;
+        }
+        Poll& p = _polls[poll];
+
+        // If a new sample was published during the copy, the buffer that was being read may
+        // have been reused by the DMA : copy again
+        unsigned int nSamples = 0;
+        do {
+            nSamples = p.nSamples;
+            const uint8_t* data = p.data[p.front];
+            for (int i = 0; i < p.size; i++) {
+                buffer[i] = data[i];
+            }
+            if (timestamp != nullptr) {
+                *timestamp = p.timestamp;
+            }
+        } while (nSamples != p.nSamples);
+
+        return nSamples > 0;
+    }
+
+    unsigned int sampleCounter(int poll) {
+        if (poll < 0 || poll >= _nPolls) {
+            return 0;
+        }
+        return _polls[poll].nSamples;
+    }
+
+    unsigned int errorCounter(int poll) {
+        if (poll < 0 || poll >= _nPolls) {
+            return 0;
+        }
+        return _polls[poll].nErrors;
+    }
+
+    unsigned int overrunCounter(int poll) {
+        if (poll < 0 || poll >= _nPolls) {
+            return 0;
+        }
+        return _polls[poll].nOverruns;
+    }
+
+}
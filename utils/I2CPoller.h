@@ -0,0 +1,32 @@
+#ifndef _I2C_POLLER_H_
+#define _I2C_POLLER_H_
+
+#include <stdint.h>
+#include <core.h>
+#include <i2c.h>
+#include <tc.h>
+
+// This helper periodically reads register blocks from I2C devices in background.
+// Each poll is defined by a port, a device address, a register and a rate. A TC counter
+// generates a tick which schedules the polls that are due, and every enabled TWIM runs
+// its own queue through the DMA, so that sensors on different buses are sampled in parallel.
+// Each poll owns a double-buffered snapshot : the DMA fills the back buffer while the
+// application reads the front buffer, which is swapped only when a transfer succeeds.
+namespace I2CPoller {
+
+    const int MAX_POLLS = 16;
+    const int MAX_DATA_SIZE = 16;
+
+    // Module API
+    int add(I2C::Port port, uint8_t address, uint8_t reg, int size, unsigned long period);
+    void setEnabled(int poll, bool enabled);
+    void start(TC::Counter counter, unsigned long tickPeriod=1);
+    void stop();
+    bool get(int poll, uint8_t* buffer, Core::Time* timestamp=nullptr);
+    unsigned int sampleCounter(int poll);
+    unsigned int errorCounter(int poll);
+    unsigned int overrunCounter(int poll);
+
+}
+
+#endif
@@ -0,0 +1,57 @@
+#include "MovingAverage.h"
+
+// Constructor : must be passed the buffer used to store the history, which must be
+// able to contain length samples (up to 128)
+MovingAverage::MovingAverage(uint16_t* history, unsigned int length, unsigned int decimation) {
+    _history = history;
+    _length = length > 0 ? length : 1;
+    _decimation = decimation > 0 ? decimation : 1;
+
+    // The division by the length is replaced by a multiplication by its reciprocal in Q31,
+    // rounded up so that the result is exact for the range of sums allowed by the maximum length
+    _reciprocal = (uint32_t)((((uint64_t)1 << 31) + _length - 1) / _length);
+
+    reset();
+}
+
+// Filter n input samples and return the number of samples written to output.
+// The output can be the same buffer as the input.
+int MovingAverage::process(const uint16_t* input, uint16_t* output, int n) {
+    uint32_t sum = _sum;
+    unsigned int cursor = _cursor;
+    unsigned int phase = _phase;
+    int nOutput = 0;
+
+    for (int i = 0; i < n; i++) {
+        // Replace the oldest sample by the new one in the sum
+        uint16_t sample = input[i];
+        sum += sample - _history[cursor];
+        _history[cursor] = sample;
+        cursor++;
+        if (cursor == _length) {
+            cursor = 0;
+        }
+
+        // Output one sample every _decimation inputs
+        phase++;
+        if (phase == _decimation) {
+            phase = 0;
+            output[nOutput++] = ((uint64_t)(sum + _length / 2) * _reciprocal) >> 31;
+        }
+    }
+
+    _sum = sum;
+    _cursor = cursor;
+    _phase = phase;
+    return nOutput;
+}
+
+// Clear the history
+void MovingAverage::reset() {
+    for (unsigned int i = 0; i < _length; i++) {
+        _history[i] = 0;
+    }
+    _sum = 0;
+    _cursor = 0;
+    _phase = 0;
+}
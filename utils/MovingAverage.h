@@ -0,0 +1,35 @@
+#ifndef _MOVING_AVERAGE_H_
+#define _MOVING_AVERAGE_H_
+
+#include <stdint.h>
+
+// This class computes a running average over the last samples of a stream, for example
+// the buffers received from ADC::startAcquisition(). The sum is updated incrementally,
+// so the cost per sample does not depend on the length of the window. With a decimation
+// factor, only one output is produced every N input samples (this is a first-order CIC
+// decimator), which reduces both the noise and the rate of the data to process.
+class MovingAverage {
+private:
+    uint16_t* _history = nullptr;
+    unsigned int _length = 0;
+    unsigned int _decimation = 1;
+    unsigned int _cursor = 0;
+    unsigned int _phase = 0;
+    uint32_t _sum = 0;
+    uint32_t _reciprocal = 0;
+
+public:
+    // Constructor : must be passed the buffer used to store the history, which must be
+    // able to contain length samples (up to 128)
+    MovingAverage(uint16_t* history, unsigned int length, unsigned int decimation=1);
+
+    // Filter n input samples and return the number of samples written to output.
+    // The output can be the same buffer as the input.
+    int process(const uint16_t* input, uint16_t* output, int n);
+
+    // Clear the history
+    void reset();
+
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include "PatternOutput.h"
+#include <core.h>
+#include <pm.h>
+
+namespace TC {
+    // Interrupt priority, defined in interrupt_priorities.cpp
+    extern uint8_t INTERRUPT_PRIORITY;
+}
+
+namespace PatternOutput {
+
+    TC::Counter _counter;
+    uint32_t _counterREG = 0;
+    volatile uint32_t* _ovrToggle = nullptr;
+    uint32_t _mask = 0;
+    const uint32_t* _values = nullptr;
+    int _n = 0;
+    int _cursor = 0;
+    bool _repeat = false;
+    uint32_t _current = 0;
+    uint32_t _nextToggle = 0;
+    volatile bool _running = false;
+    uint32_t _handler = 0;
+
+    void interruptHandler();
+
+    // Start playing the n values on the pins of the given port selected by the mask (the pins must
+    // already be enabled as outputs), at the given rate in Hz. Each value is a port-wide word : bit i
+    // is the state of pin i, and the bits outside of the mask are ignored. The handler is called at
+    // the end of the sequence, unless repeat is enabled.
+    bool start(TC::Counter counter, GPIO::Port port, uint32_t mask, const uint32_t* values, int n, unsigned long frequency, bool repeat, void (*handler)()) {
+        if (n <= 0 || frequency == 0) {
+            return false;
+        }
+        stop();
+
+        // Find the fastest source clock which allows this step period on 16 bits
+        unsigned long frequencyPBA = PM::getModuleClockFrequency(PM::CLK_TC0 + counter.tc);
+        const TC::SourceClock clocks[] = {TC::SourceClock::PBA_OVER_2, TC::SourceClock::PBA_OVER_8, TC::SourceClock::PBA_OVER_32, TC::SourceClock::PBA_OVER_128};
+        const int shifts[] = {1, 3, 5, 7};
+        int clock = -1;
+        unsigned long rc = 0;
+        for (int i = 0; i < 4; i++) {
+            rc = (frequencyPBA >> shifts[i]) / frequency;
+            if (rc > 0 && rc <= 0x10000) {
+                clock = i;
+                break;
+            }
+        }
+        if (clock == -1) {
+            return false;
+        }
+
+        // Save the sequence
+        _counter = counter;
+        _counterREG = TC::TC_BASE + counter.tc * TC::TC_SIZE + counter.n * TC::OFFSET_COUNTER_SIZE;
+        uint32_t portREG = GPIO::GPIO_BASE + static_cast<int>(port) * GPIO::PORT_REG_SIZE;
+        _ovrToggle = &((volatile GPIO::RSCT_REG*)(portREG + GPIO::OFFSET_OVR))->TOGGLE;
+        _mask = mask;
+        _values = values;
+        _n = n;
+        _cursor = 0;
+        _repeat = repeat;
+        _handler = (uint32_t)handler;
+
+        // Precompute the first step from the current state of the pins
+        _current = (*(volatile uint32_t*)(portREG + GPIO::OFFSET_OVR)) & mask;
+        _nextToggle = (values[0] & mask) ^ _current;
+        _current ^= _nextToggle;
+        _running = true;
+
+        // Configure the counter to restart automatically on RC compare, and route its interrupt
+        // directly to the pattern handler to avoid the overhead of the generic TC dispatcher
+        TC::enableSimpleCounter(counter, rc - 1, clocks[clock]);
+        Core::Interrupt interrupt = static_cast<Core::Interrupt>(static_cast<int>(Core::Interrupt::TC00) + counter.tc * TC::N_COUNTERS_PER_TC + counter.n);
+        Core::setInterruptHandler(interrupt, interruptHandler);
+        Core::enableInterrupt(interrupt, TC::INTERRUPT_PRIORITY);
+
+        // SR (Status Register) : clear any pending flag
+        (*(volatile uint32_t*)(_counterREG + TC::OFFSET_SR0));
+
+        // IER (Interrupt Enable Register) : enable the RC compare interrupt
+        (*(volatile uint32_t*)(_counterREG + TC::OFFSET_IER0))
+            = 1 << TC::SR_CPCS;
+
+        // Restart the counter from 0 so that the first step happens one full period from now
+        TC::start(counter);
+        return true;
+    }
+
+    // Stop the sequence. The pins keep their current state.
+    void stop() {
+        if (!_running) {
+            return;
+        }
+
+        // IDR (Interrupt Disable Register) : disable the RC compare interrupt
+        (*(volatile uint32_t*)(_counterREG + TC::OFFSET_IDR0))
+            = 1 << TC::SR_CPCS;
+        TC::stop(_counter);
+        _running = false;
+    }
+
+    bool isFinished() {
+        return !_running;
+    }
+
+    void interruptHandler() {
+        // Output the step precomputed during the previous interrupt
+        *_ovrToggle = _nextToggle;
+
+        // SR (Status Register) : read the register to clear the interrupt
+        (*(volatile uint32_t*)(_counterREG + TC::OFFSET_SR0));
+
+        // Move to the next value
+        _cursor++;
+        if (_cursor == _n) {
+            if (!_repeat) {
+                stop();
+                void (*handler)() = (void (*)())_handler;
+                if (handler != nullptr) {
+                    handler();
+                }
+                return;
+            }
+            _cursor = 0;
+        }
+
+        // Precompute the next step
+        _nextToggle = (_values[_cursor] & _mask) ^ _current;
+        _current ^= _nextToggle;
+    }
+
+}
@@ -0,0 +1,25 @@
+#ifndef _PATTERN_OUTPUT_H_
+#define _PATTERN_OUTPUT_H_
+
+#include <stdint.h>
+#include <gpio.h>
+#include <tc.h>
+
+// This helper plays a precomputed sequence of values on a group of pins of the same port,
+// paced by a TC counter, for example to drive a parallel bus or stepper motor pulse trains
+// without cycle-counted loops. The PDCA cannot write to the GPIO controller, so each step is
+// written by the RC compare interrupt of the counter. The write is the first thing done by the
+// handler and uses the OVR toggle register, which changes all the pins of the mask in a single
+// access without affecting the other pins of the port : the jitter is then only the interrupt
+// latency, which is constant as long as no higher-priority interrupt is running.
+// Each step costs a few dozen cycles, so the step rate is limited to a few hundred kHz.
+namespace PatternOutput {
+
+    // Module API
+    bool start(TC::Counter counter, GPIO::Port port, uint32_t mask, const uint32_t* values, int n, unsigned long frequency, bool repeat=false, void (*handler)()=nullptr);
+    void stop();
+    bool isFinished();
+
+}
+
+#endif
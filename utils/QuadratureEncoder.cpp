@@ -0,0 +1,250 @@
+#include "QuadratureEncoder.h"
+#include <core.h>
+
+// Position change for each transition at low speed, indexed by the previous and the new state
+// (A in bit 1 and B in bit 0). When A leads B, the states follow the sequence 0, 2, 3, 1.
+// The transitions where both pins changed (0 <-> 3 and 1 <-> 2) cannot be decoded and are
+// counted as errors.
+static const int8_t TRANSITIONS[16] = {
+//  new state : 0   1   2   3
+                0, -1, +1,  0, // previous state 0
+               +1,  0,  0, -1, // previous state 1
+               -1,  0,  0, +1, // previous state 2
+                0, +1, -1,  0, // previous state 3
+};
+
+// Number of counts since the last rising edge of A, for each state, when moving forward
+// (state 2 follows the rising edge) and backward (state 3 follows the rising edge). The position
+// counted in hardware is therefore exact at each rising edge of A.
+static const uint8_t PHASE_FORWARD[4] = {3, 2, 0, 1};
+static const uint8_t PHASE_BACKWARD[4] = {2, 3, 1, 0};
+
+// Constructor : must be passed the pins of the A and B channels, the TC counter which counts the
+// edges of A (A must be the CLKn pin of this counter), and another TC counter for the tick interrupt.
+// By default, the position increases when A leads B ; set reverse to invert it.
+QuadratureEncoder::QuadratureEncoder(GPIO::Pin pinA, GPIO::Pin pinB, TC::Counter counter, TC::Counter tickCounter, bool reverse) {
+    _pinA = pinA;
+    _pinB = pinB;
+    _counter = counter;
+    _tickCounter = tickCounter;
+    _reverse = reverse;
+}
+
+// Start decoding, from the current position
+bool QuadratureEncoder::enable() {
+    if (_enabled) {
+        return true;
+    }
+    if (_counter.tc == _tickCounter.tc && _counter.n == _tickCounter.n) {
+        return false;
+    }
+
+    // Enable the input buffer and the pull-up of the pins, then route A to the clock input of
+    // the counter, which counts its rising edges modulo 2^16
+    GPIO::enableInput(_pinA, GPIO::Pulling::PULLUP);
+    GPIO::enableInput(_pinB, GPIO::Pulling::PULLUP);
+    TC::setPin({_counter, TC::TIOA}, TC::PinFunction::CLK, _pinA);
+    TC::enableSimpleCounter(_counter, 0xFFFF, static_cast<TC::SourceClock>(static_cast<int>(TC::SourceClock::CLK0) + _counter.n));
+
+    uint32_t primask = Core::enterCriticalSection();
+    _state = sample(&_tickCounterValue);
+    _tickPosition = _position;
+    _fast = false;
+    _errors = 0;
+    Core::exitCriticalSection(primask);
+
+    enablePinInterrupts();
+    TC::execDelayed(_tickCounter, Callback<>::bind<QuadratureEncoder, &QuadratureEncoder::tickHandler>(this), TICK_PERIOD, TC::Unit::MILLISECONDS, true);
+    _enabled = true;
+    return true;
+}
+
+// Stop decoding ; the position is kept
+void QuadratureEncoder::disable() {
+    if (!_enabled) {
+        return;
+    }
+    disableIndex();
+    TC::disable(_tickCounter);
+
+    // Bring the position up to date before the counter is stopped
+    uint32_t primask = Core::enterCriticalSection();
+    _position = rawPosition();
+    _fast = false;
+    Core::exitCriticalSection(primask);
+
+    disablePinInterrupts();
+    TC::disable(_counter);
+    _enabled = false;
+}
+
+// Speeds, in periods of the signals per millisecond, above which the position is counted in
+// hardware and below which it is decoded from the pin change interrupts again
+void QuadratureEncoder::setSpeedThresholds(unsigned int low, unsigned int high) {
+    _lowSpeed = low;
+    _highSpeed = high > low ? high : low + 1;
+}
+
+// Current position, in counts (4 per period of the signals). This can be called from any context.
+int32_t QuadratureEncoder::position() {
+    uint32_t primask = Core::enterCriticalSection();
+    int32_t position = rawPosition() + _offset;
+    Core::exitCriticalSection(primask);
+    return position;
+}
+
+// Change the current position without losing any count
+void QuadratureEncoder::setPosition(int32_t position) {
+    uint32_t primask = Core::enterCriticalSection();
+    _offset = position - rawPosition();
+    Core::exitCriticalSection(primask);
+}
+
+// Handle the index pulse of the encoder on the given pin. On each rising edge, the position is
+// latched, reset to 0 if reset is true, and given to the handler.
+void QuadratureEncoder::enableIndex(GPIO::Pin pin, bool reset, Callback<int32_t> handler) {
+    disableIndex();
+    _pinIndex = pin;
+    _indexReset = reset;
+    _indexHandler = handler;
+    _indexPosition = 0;
+    _indexEnabled = true;
+    GPIO::enableInput(pin, GPIO::Pulling::PULLUP);
+    GPIO::enableInterrupt(pin, Callback<>::bind<QuadratureEncoder, &QuadratureEncoder::indexHandler>(this), GPIO::Trigger::RISING);
+}
+
+void QuadratureEncoder::disableIndex() {
+    if (!_indexEnabled) {
+        return;
+    }
+    _indexEnabled = false;
+    GPIO::disableInterrupt(_pinIndex);
+}
+
+// Internal function which reads the state of the pins (A in bit 1 and B in bit 0) together with
+// the value of the counter : the counter is read again until no rising edge of A has been counted
+// while the pins were read
+uint8_t QuadratureEncoder::sample(uint16_t* counterValue) {
+    uint16_t before = 0;
+    uint16_t after = TC::counterValue(_counter);
+    uint8_t state = 0;
+    do {
+        before = after;
+        if (_pinA.port == _pinB.port) {
+            uint32_t pvr = GPIO::get(_pinA | _pinB);
+            state = ((pvr >> _pinA.number) & 1) << 1 | ((pvr >> _pinB.number) & 1);
+        } else {
+            state = (GPIO::get(_pinA) ? 2 : 0) | (GPIO::get(_pinB) ? 1 : 0);
+        }
+        after = TC::counterValue(_counter);
+    } while (after != before);
+    *counterValue = after;
+    return state;
+}
+
+// Internal function which updates the position from the new state of the pins, at low speed.
+// Must be called in a critical section.
+void QuadratureEncoder::decode(uint8_t state) {
+    if ((state ^ _state) == 0b11) {
+        _errors = _errors + 1;
+    } else {
+        int delta = TRANSITIONS[_state << 2 | state];
+        _position += _reverse ? -delta : delta;
+    }
+    _state = state;
+}
+
+// Internal function which returns the position without the offset. Must be called in a critical section.
+int32_t QuadratureEncoder::rawPosition() {
+    if (!_fast) {
+        return _position;
+    }
+    // Until the first rising edge of A, the position stays where the hardware counting was entered
+    uint32_t periods = _fastPeriods + (uint16_t)(TC::counterValue(_counter) - _fastCounterBase);
+    if (periods == 0) {
+        return _position;
+    }
+    return _position + _fastDirection * (int32_t)(4 * periods - _fastPhase);
+}
+
+void QuadratureEncoder::enablePinInterrupts() {
+    Callback<> handler = Callback<>::bind<QuadratureEncoder, &QuadratureEncoder::edgeHandler>(this);
+    GPIO::enableInterrupt(_pinA, handler, GPIO::Trigger::CHANGE);
+    GPIO::enableInterrupt(_pinB, handler, GPIO::Trigger::CHANGE);
+}
+
+void QuadratureEncoder::disablePinInterrupts() {
+    GPIO::disableInterrupt(_pinA);
+    GPIO::disableInterrupt(_pinB);
+}
+
+// Pin change interrupt of the A and B pins, at low speed. The interrupt flags are cleared by the
+// GPIO driver before the handler is called, so an edge happening while the pins are read triggers
+// the handler again instead of being lost.
+void QuadratureEncoder::edgeHandler() {
+    uint32_t primask = Core::enterCriticalSection();
+    if (!_fast) {
+        uint16_t counterValue = 0;
+        decode(sample(&counterValue));
+    }
+    Core::exitCriticalSection(primask);
+}
+
+// Tick interrupt : measure the speed and switch between the decoding modes
+void QuadratureEncoder::tickHandler() {
+    uint32_t primask = Core::enterCriticalSection();
+    uint16_t counterValue = 0;
+    uint8_t state = sample(&counterValue);
+    uint16_t periods = counterValue - _tickCounterValue;
+    _tickCounterValue = counterValue;
+
+    if (_fast) {
+        // Accumulate the rising edges of A, so that the 16-bit counter never wraps around
+        _fastPeriods += (uint16_t)(counterValue - _fastCounterBase);
+        _fastCounterBase = counterValue;
+
+        if (periods < _lowSpeed) {
+            // Back to the pin change interrupts : the exact number of counts since the hardware
+            // counting was entered is given by the rising edges of A and the phase of the pins
+            // in the sequence, in the direction of the encoder
+            const uint8_t* phase = (_fastDirection > 0) != _reverse ? PHASE_FORWARD : PHASE_BACKWARD;
+            _position += _fastDirection * (int32_t)(4 * _fastPeriods + phase[state] - _fastPhase);
+            _state = state;
+            _fast = false;
+            enablePinInterrupts();
+        }
+
+    } else {
+        // Handle the edges which are still pending in the GPIO, then check the speed
+        decode(state);
+        int32_t delta = _position - _tickPosition;
+        if (delta >= (int32_t)(4 * _highSpeed) || delta <= -(int32_t)(4 * _highSpeed)) {
+            disablePinInterrupts();
+            _fastDirection = delta > 0 ? 1 : -1;
+            const uint8_t* phase = (_fastDirection > 0) != _reverse ? PHASE_FORWARD : PHASE_BACKWARD;
+            _fastPhase = phase[state];
+            _fastCounterBase = counterValue;
+            _fastPeriods = 0;
+            _fast = true;
+        }
+    }
+
+    _tickPosition = rawPosition();
+    Core::exitCriticalSection(primask);
+}
+
+// Rising edge interrupt of the index pin
+void QuadratureEncoder::indexHandler() {
+    uint32_t primask = Core::enterCriticalSection();
+    int32_t raw = rawPosition();
+    int32_t position = raw + _offset;
+    _indexPosition = position;
+    if (_indexReset) {
+        _offset = -raw;
+    }
+    Core::exitCriticalSection(primask);
+
+    if (_indexHandler) {
+        _indexHandler(position);
+    }
+}
@@ -0,0 +1,122 @@
+#ifndef _QUADRATURE_ENCODER_H_
+#define _QUADRATURE_ENCODER_H_
+
+#include <stdint.h>
+#include <gpio.h>
+#include <tc.h>
+#include <callback.h>
+
+// This class decodes the A/B signals of an incremental encoder. The position is counted in
+// hardware by a TC at high speed, so that the CPU load does not grow with the speed.
+// The SAM4L has no quadrature decoder : the TC clock and burst inputs and the GLOC LUTs are
+// combinational, and any combination of A and B has as many edges in one direction as in the
+// other, so the direction can only be found by sampling one channel on the edges of the other.
+// The decoding therefore switches between two modes, checked every millisecond by a tick
+// interrupt of a second TC counter :
+// - at low speed, both pins trigger a pin change interrupt which reads them and updates the
+//   position with a Gray code table, 4 counts per period of the signals. A bouncing signal only
+//   moves the position back and forth between two adjacent counts. When both pins are seen
+//   changed at once (an edge was missed), the direction is unknown, the position is not changed
+//   and errors() is incremented ;
+// - above the high speed threshold, the pin change interrupts are disabled and the TC counts the
+//   rising edges of A in hardware, in the direction the encoder had when the mode was entered.
+//   The position is exact at each rising edge of A and up to 3 counts late between them. The
+//   position is brought back to the exact count from the state of the pins when the speed falls
+//   below the low speed threshold.
+// At low speed, the CPU takes at most 4 interrupts per period of the signals, i.e. 4 times the
+// high threshold per millisecond ; at high speed, it only takes the tick interrupt.
+// A change of direction cannot be seen in hardware counting mode : the encoder must slow down
+// below the low threshold and stay there for one tick (1ms) before it reverses. With the
+// default thresholds (4 and 8 periods per ms), this is always true for mechanical systems which
+// cannot stop in less than 1ms from 4000 periods per second, and the thresholds can be raised
+// for systems which can.
+// The A pin must be the CLKn pin of the TC whose counter n is used for counting (given with its
+// peripheral function, see pins_sam4l_XX.cpp). It is still read by the GPIO controller while it
+// is routed to the TC : the pin value and the pin change interrupts stay available when a pin is
+// controlled by a peripheral.
+// The index pulse, if any, is handled by a rising edge interrupt on another pin, which latches
+// the position and can reset it to 0.
+class QuadratureEncoder {
+private:
+    GPIO::Pin _pinA;
+    GPIO::Pin _pinB;
+    TC::Counter _counter;
+    TC::Counter _tickCounter;
+    bool _reverse;
+    bool _enabled = false;
+    unsigned int _lowSpeed = DEFAULT_LOW_SPEED;
+    unsigned int _highSpeed = DEFAULT_HIGH_SPEED;
+
+    // Pin change decoding
+    uint8_t _state = 0;
+    int32_t _position = 0;
+    volatile unsigned int _errors = 0;
+
+    // Hardware counting
+    bool _fast = false;
+    int _fastDirection = 0;
+    uint8_t _fastPhase = 0;
+    uint16_t _fastCounterBase = 0;
+    uint32_t _fastPeriods = 0;
+
+    // Speed measurement, at each tick
+    uint16_t _tickCounterValue = 0;
+    int32_t _tickPosition = 0;
+
+    int32_t _offset = 0;
+
+    GPIO::Pin _pinIndex;
+    bool _indexEnabled = false;
+    bool _indexReset = false;
+    volatile int32_t _indexPosition = 0;
+    Callback<int32_t> _indexHandler;
+
+    static const unsigned int TICK_PERIOD = 1; // ms
+    static const unsigned int DEFAULT_LOW_SPEED = 4;
+    static const unsigned int DEFAULT_HIGH_SPEED = 8;
+
+    uint8_t sample(uint16_t* counterValue);
+    void decode(uint8_t state);
+    int32_t rawPosition();
+    void enablePinInterrupts();
+    void disablePinInterrupts();
+    void edgeHandler();
+    void tickHandler();
+    void indexHandler();
+
+public:
+    // Constructor : must be passed the pins of the A and B channels, the TC counter which counts the
+    // edges of A (A must be the CLKn pin of this counter, see above), and another TC counter for the
+    // tick interrupt. By default, the position increases when A leads B ; set reverse to invert it.
+    QuadratureEncoder(GPIO::Pin pinA, GPIO::Pin pinB, TC::Counter counter, TC::Counter tickCounter, bool reverse=false);
+
+    // Start and stop decoding. The pins are configured as inputs with pull-ups, which are
+    // required by open-collector encoders and harmless for the others.
+    bool enable();
+    void disable();
+
+    // Speeds, in periods of the signals per millisecond, above which the position is counted in
+    // hardware and below which it is decoded from the pin change interrupts again
+    void setSpeedThresholds(unsigned int low=DEFAULT_LOW_SPEED, unsigned int high=DEFAULT_HIGH_SPEED);
+
+    // Current position, in counts (4 per period of the signals). This can be called from any context.
+    int32_t position();
+    void setPosition(int32_t position);
+
+    // Number of transitions which could not be decoded since enable()
+    inline unsigned int errors() { return _errors; }
+
+    // True while the position is counted in hardware
+    inline bool isCountingInHardware() { return _fast; }
+
+    // Handle the index pulse of the encoder on the given pin. On each rising edge, the position is
+    // latched, reset to 0 if reset is true, and given to the handler.
+    void enableIndex(GPIO::Pin pin, bool reset=true, Callback<int32_t> handler=nullptr);
+    void disableIndex();
+
+    // Position latched by the last index pulse, before it was reset
+    inline int32_t indexPosition() { return _indexPosition; }
+
+};
+
+#endif
@@ -0,0 +1,215 @@
+#include "Scheduler.h"
+#include <ast.h>
+
+namespace Scheduler {
+
+    enum class Type {
+        TIMER,
+        PERIODIC,
+        EVENT,
+    };
+
+    struct Task {
+        bool used;
+        bool enabled;
+        Type type;
+        uint32_t handler;
+        uint64_t deadline;
+        unsigned long period;
+        volatile bool triggered;
+    };
+
+    // List of tasks
+    Task _tasks[MAX_TASKS];
+
+    // Set by trigger() to signal that at least one event task is pending
+    volatile bool _pending = false;
+
+    Core::SleepMode _maxSleepMode = Core::SleepMode::SLEEP0;
+
+    // Time of the alarm currently programmed in the AST, if any
+    bool _alarmEnabled = false;
+    uint64_t _alarmTime = 0;
+
+    // Internal function which registers a new task and returns its index, or -1 if the table is full
+    int add(Type type, void (*handler)(), uint64_t deadline, unsigned long period) {
+        if (handler == nullptr) {
+            return -1;
+        }
+        for (int i = 0; i < MAX_TASKS; i++) {
+            Task& t = _tasks[i];
+            if (!t.used) {
+                t.type = type;
+                t.handler = (uint32_t)handler;
+                t.deadline = deadline;
+                t.period = period;
+                t.triggered = false;
+                t.enabled = true;
+                t.used = true;
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Call the handler once, after the given delay in ms
+    int addTimer(void (*handler)(), unsigned long delay) {
+        return add(Type::TIMER, handler, Core::time() + delay, 0);
+    }
+
+    // Call the handler every period ms, the first time after the given delay
+    int addPeriodic(void (*handler)(), unsigned long period, unsigned long delay) {
+        if (period == 0) {
+            return -1;
+        }
+        return add(Type::PERIODIC, handler, Core::time() + delay, period);
+    }
+
+    // Call the handler each time trigger() is called for this task
+    int addEvent(void (*handler)()) {
+        return add(Type::EVENT, handler, 0, 0);
+    }
+
+    void remove(int task) {
+        if (task < 0 || task >= MAX_TASKS) {
+            return;
+        }
+        _tasks[task].used = false;
+    }
+
+    // Disabling a task keeps its slot. When a periodic task is enabled again, it is restarted
+    // one period from now.
+    void setEnabled(int task, bool enabled) {
+        if (task < 0 || task >= MAX_TASKS || !_tasks[task].used) {
+            return;
+        }
+        Task& t = _tasks[task];
+        if (enabled && !t.enabled && t.type == Type::PERIODIC) {
+            t.deadline = Core::time() + t.period;
+        }
+        t.enabled = enabled;
+    }
+
+    // Mark an event task as pending. This can be called from an interrupt handler : the
+    // task will be executed by the scheduler as soon as the current task is finished.
+    // Several triggers before the task runs are coalesced.
+    void trigger(int task) {
+        if (task < 0 || task >= MAX_TASKS) {
+            return;
+        }
+        _tasks[task].triggered = true;
+        _pending = true;
+    }
+
+    // Set the deepest sleep mode the scheduler is allowed to use when it is idle. The
+    // peripherals which must wake the chip up or keep running (e.g. an USART receiving data)
+    // must be able to do so in this mode.
+    void setMaxSleepMode(Core::SleepMode mode) {
+        _maxSleepMode = mode;
+    }
+
+    // Execute every task which is due, and return true if at least one task was executed
+    bool runOnce() {
+        bool executed = false;
+
+        // Event tasks
+        if (_pending) {
+            _pending = false;
+            for (int i = 0; i < MAX_TASKS; i++) {
+                Task& t = _tasks[i];
+                if (t.used && t.type == Type::EVENT && t.triggered) {
+                    t.triggered = false;
+                    if (t.enabled) {
+                        ((void (*)())t.handler)();
+                        executed = true;
+                    }
+                }
+            }
+        }
+
+        // Timers and periodic tasks
+        uint64_t now = Core::time();
+        for (int i = 0; i < MAX_TASKS; i++) {
+            Task& t = _tasks[i];
+            if (!t.used || !t.enabled || t.type == Type::EVENT || t.deadline > now) {
+                continue;
+            }
+            if (t.type == Type::TIMER) {
+                t.used = false;
+            } else {
+                // Schedule the next execution relative to this deadline. If the task is late by
+                // more than one period, the missed executions are skipped.
+                t.deadline += t.period;
+                if (t.deadline <= now) {
+                    t.deadline += ((now - t.deadline) / t.period + 1) * t.period;
+                }
+            }
+            ((void (*)())t.handler)();
+            executed = true;
+            now = Core::time();
+        }
+
+        return executed;
+    }
+
+    // Internal function which sleeps until the next deadline or any interrupt
+    void sleep() {
+        // Find the next deadline
+        bool hasDeadline = false;
+        uint64_t deadline = 0;
+        for (int i = 0; i < MAX_TASKS; i++) {
+            Task& t = _tasks[i];
+            if (t.used && t.enabled && t.type != Type::EVENT && (!hasDeadline || t.deadline < deadline)) {
+                deadline = t.deadline;
+                hasDeadline = true;
+            }
+        }
+
+        // Program the alarm only if the deadline has changed, since writing the AST registers
+        // requires waiting for the synchronization with its 32kHz clock domain
+        uint64_t now = Core::time();
+        if (hasDeadline) {
+            if (deadline <= now) {
+                return;
+            }
+            if (!_alarmEnabled || _alarmTime != deadline || AST::alarmPassed()) {
+                AST::enableAlarm(deadline, false);
+                _alarmEnabled = true;
+                _alarmTime = deadline;
+            }
+        } else if (_alarmEnabled) {
+            AST::disableAlarm();
+            _alarmEnabled = false;
+        }
+
+        // Select the sleep mode : deep modes have a longer wake-up time
+        Core::SleepMode mode = _maxSleepMode;
+        if (hasDeadline && deadline - now < DEEP_SLEEP_MIN_DELAY) {
+            mode = Core::SleepMode::SLEEP0;
+        }
+        Core::setSleepMode(mode);
+
+        // Check for pending events and sleep with interrupts masked : an interrupt which would
+        // trigger an event between the check and WFI still wakes the chip up, and is then
+        // handled when interrupts are enabled again
+        Core::disableInterrupts();
+        if (!_pending) {
+            Core::waitForInterrupt();
+        }
+        Core::enableInterrupts();
+
+        if (_alarmEnabled && Core::time() >= _alarmTime) {
+            _alarmEnabled = false;
+        }
+    }
+
+    // Run the scheduler forever
+    void run() {
+        while (true) {
+            if (!runOnce()) {
+                sleep();
+            }
+        }
+    }
+
+}
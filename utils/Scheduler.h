@@ -0,0 +1,36 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <stdint.h>
+#include <core.h>
+
+// This helper replaces the polling superloop with a cooperative scheduler. Tasks are
+// either one-shot timers, periodic tasks or event tasks triggered with trigger() (which
+// can be called from an interrupt). Tasks run to completion one after the other from
+// run(). Between them, the scheduler programs a single AST alarm for the next deadline
+// and puts the chip to sleep until this alarm or any other interrupt, in the deepest
+// sleep mode allowed by the application.
+// Periodic tasks are scheduled relative to their previous deadline rather than to the
+// end of their previous execution, so they do not drift when other tasks are slow.
+namespace Scheduler {
+
+    const int MAX_TASKS = 16;
+
+    // Below this delay before the next deadline (in ms), the chip only enters SLEEP0,
+    // which has the shortest wake-up time
+    const unsigned long DEEP_SLEEP_MIN_DELAY = 10;
+
+    // Module API
+    int addTimer(void (*handler)(), unsigned long delay);
+    int addPeriodic(void (*handler)(), unsigned long period, unsigned long delay=0);
+    int addEvent(void (*handler)());
+    void remove(int task);
+    void setEnabled(int task, bool enabled);
+    void trigger(int task);
+    void setMaxSleepMode(Core::SleepMode mode);
+    bool runOnce();
+    void run();
+
+}
+
+#endif
@@ -0,0 +1,170 @@
+#include "Synth.h"
+#include <core.h>
+#include <dac.h>
+
+namespace Synth {
+
+    // One period of a sine in Q15, with the first value repeated at the end for the interpolation
+    const int16_t SINE_TABLE[257] = {
+        0, 804, 1608, 2410, 3212, 4011, 4808, 5602,
+        6393, 7179, 7962, 8739, 9512, 10278, 11039, 11793,
+        12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+        18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+        23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+        27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+        30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+        32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+        32767, 32757, 32728, 32678, 32609, 32521, 32412, 32285,
+        32137, 31971, 31785, 31580, 31356, 31113, 30852, 30571,
+        30273, 29956, 29621, 29268, 28898, 28510, 28105, 27683,
+        27245, 26790, 26319, 25832, 25329, 24811, 24279, 23731,
+        23170, 22594, 22005, 21403, 20787, 20159, 19519, 18868,
+        18204, 17530, 16846, 16151, 15446, 14732, 14010, 13279,
+        12539, 11793, 11039, 10278, 9512, 8739, 7962, 7179,
+        6393, 5602, 4808, 4011, 3212, 2410, 1608, 804,
+        0, -804, -1608, -2410, -3212, -4011, -4808, -5602,
+        -6393, -7179, -7962, -8739, -9512, -10278, -11039, -11793,
+        -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530,
+        -18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+        -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+        -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956,
+        -30273, -30571, -30852, -31113, -31356, -31580, -31785, -31971,
+        -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+        -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285,
+        -32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571,
+        -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+        -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731,
+        -23170, -22594, -22005, -21403, -20787, -20159, -19519, -18868,
+        -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+        -12539, -11793, -11039, -10278, -9512, -8739, -7962, -7179,
+        -6393, -5602, -4808, -4011, -3212, -2410, -1608, -804,
+        0
+    };
+
+    // Current state of the synthesizer
+    Waveform _waveform = Waveform::SINE;
+    const int16_t* _table = nullptr;
+    int _tableShift = 0;
+    unsigned long _sampleRate = 0;
+    unsigned long _frequency = 0;
+    volatile uint32_t _phase = 0;
+    volatile uint32_t _increment = 0;
+    volatile uint16_t _amplitude = 511;
+    volatile uint16_t _offset = 512;
+
+    // Internal function which computes the phase increment for the current frequency and sample rate
+    void updateIncrement() {
+        if (_sampleRate == 0) {
+            _increment = 0;
+            return;
+        }
+        _increment = ((uint64_t)_frequency << 32) / ((uint64_t)_sampleRate * 1000);
+    }
+
+    // Start generating the waveform on the DAC at the given sample rate (in Hz), using the given
+    // buffer as a double buffer : a longer buffer tolerates a longer interrupt latency, a shorter
+    // one makes the frequency changes take effect sooner
+    bool start(unsigned long sampleRate, uint16_t* buffer, int size) {
+        if (!DAC::setFrequency(sampleRate)) {
+            return false;
+        }
+        _sampleRate = sampleRate;
+        updateIncrement();
+        return DAC::startStream(buffer, size, render);
+    }
+
+    void stop() {
+        DAC::stop();
+    }
+
+    // Select the waveform. For Waveform::TABLE, the table contains one period in Q15 and its
+    // size must be a power of two.
+    void setWaveform(Waveform waveform, const int16_t* table, int tableSize) {
+        int shift = 32;
+        if (waveform == Waveform::TABLE) {
+            if (table == nullptr || tableSize < 2 || (tableSize & (tableSize - 1)) != 0) {
+                return;
+            }
+            while (tableSize > 1) {
+                tableSize >>= 1;
+                shift--;
+            }
+        }
+
+        // The waveform may currently be rendered from an interrupt
+        Core::disableInterrupts();
+        _waveform = waveform;
+        _table = table;
+        _tableShift = shift;
+        Core::enableInterrupts();
+    }
+
+    // Set the frequency in mHz. This only updates the phase increment, so the change is
+    // continuous in phase and takes effect with the next rendered block.
+    void setFrequency(unsigned long frequency) {
+        _frequency = frequency;
+        updateIncrement();
+    }
+
+    // Set the peak amplitude and the center of the waveform, in DAC counts
+    void setAmplitude(uint16_t amplitude, uint16_t offset) {
+        _amplitude = amplitude;
+        _offset = offset;
+    }
+
+    // Render the next n samples of the waveform. This is the handler of DAC::startStream(), but it
+    // can also be used to fill a buffer for DAC::start().
+    int render(uint16_t* samples, int n) {
+        uint32_t phase = _phase;
+        const uint32_t increment = _increment;
+        const int32_t amplitude = _amplitude;
+        const int32_t offset = _offset;
+
+        for (int i = 0; i < n; i++) {
+            // Compute the sample in Q15
+            int32_t value = 0;
+            switch (_waveform) {
+                case Waveform::SINE:
+                    {
+                        // Interpolate linearly between two entries of the table
+                        uint32_t index = phase >> 24;
+                        int32_t frac = (phase >> 16) & 0xFF;
+                        int32_t a = SINE_TABLE[index];
+                        int32_t b = SINE_TABLE[index + 1];
+                        value = a + (((b - a) * frac) >> 8);
+                    }
+                    break;
+
+                case Waveform::TRIANGLE:
+                    value = (int32_t)(((phase & 0x80000000) ? ~phase : phase) >> 15) - 32768;
+                    break;
+
+                case Waveform::SAW:
+                    value = (int32_t)(phase >> 16) - 32768;
+                    break;
+
+                case Waveform::SQUARE:
+                    value = (phase & 0x80000000) ? -32767 : 32767;
+                    break;
+
+                case Waveform::TABLE:
+                    value = _table[phase >> _tableShift];
+                    break;
+            }
+            phase += increment;
+
+            // Scale and saturate to the DAC range
+            value = offset + ((value * amplitude) >> 15);
+            if (value < 0) {
+                value = 0;
+            } else if (value > 1023) {
+                value = 1023;
+            }
+            samples[i] = value;
+        }
+
+        _phase = phase;
+        return n;
+    }
+
+}
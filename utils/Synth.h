@@ -0,0 +1,32 @@
+#ifndef _SYNTH_H_
+#define _SYNTH_H_
+
+#include <stdint.h>
+
+// This helper generates periodic waveforms on the DAC using direct digital synthesis.
+// A 32-bit phase accumulator is advanced by a fixed increment at each sample, and its
+// upper bits index the waveform, so the frequency can be changed at any time (even
+// from an interrupt) with a resolution of a fraction of a Hz, without restarting the
+// DMA. The samples are rendered block by block into the double buffer used by
+// DAC::startStream(), and no memory is allocated.
+namespace Synth {
+
+    enum class Waveform {
+        SINE,
+        TRIANGLE,
+        SAW,
+        SQUARE,
+        TABLE,
+    };
+
+    // Module API
+    bool start(unsigned long sampleRate, uint16_t* buffer, int size);
+    void stop();
+    void setWaveform(Waveform waveform, const int16_t* table=nullptr, int tableSize=0);
+    void setFrequency(unsigned long frequency); // in mHz
+    void setAmplitude(uint16_t amplitude, uint16_t offset=512);
+    int render(uint16_t* samples, int n);
+
+}
+
+#endif
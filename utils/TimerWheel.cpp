@@ -0,0 +1,187 @@
+#include "TimerWheel.h"
+#include <core.h>
+#include <ast.h>
+
+namespace TimerWheel {
+
+    // Each slot is a doubly-linked list of timers. Each timer points to the pointer which
+    // points to it (the head of the slot or the next field of the previous timer), so that
+    // it can be unlinked without knowing its slot.
+    Timer* _wheel[N_LEVELS][N_SLOTS];
+
+    // Next tick to process
+    volatile uint32_t _now = 0;
+
+    // Internal functions
+    void callDeferred(uint32_t timer);
+
+
+    // Tick with the given TC counter. The counter is reserved until the end of the program.
+    void initTC(TC::Counter counter, unsigned long tickPeriod, TC::Unit unit) {
+        TC::execDelayed(counter, tick, tickPeriod, unit, true);
+    }
+
+    // Tick with the AST periodic interrupt, every 2^(interval+1) cycles of the 32768Hz clock.
+    // The periodic interrupt is also used by the Monotonic module : only one of them can use it.
+    void initAST(uint8_t interval) {
+        AST::enablePeriodicInterrupt(interval, tick);
+    }
+
+    // Current tick count
+    uint32_t now() {
+        return _now;
+    }
+
+    // Internal function which adds the timer to the slot corresponding to its expiry.
+    // Must be called in a critical section.
+    void insert(Timer& timer) {
+        uint32_t expiry = timer.expiry;
+        int32_t delta = (int32_t)(expiry - _now);
+        Timer** slot = nullptr;
+
+        if (delta < 0) {
+            // Already expired : put it in the next slot to process
+            slot = &_wheel[0][_now & (N_SLOTS - 1)];
+
+        } else {
+            // Find the level whose range covers the delay. Longer delays are put in the last level
+            // at the end of its range, and are cascaded again when this slot is reached.
+            int level = 0;
+            while (level < N_LEVELS - 1 && (uint32_t)delta >= (uint32_t)1 << ((level + 1) * SLOT_BITS)) {
+                level++;
+            }
+            if ((uint32_t)delta >= (uint32_t)1 << (N_LEVELS * SLOT_BITS)) {
+                expiry = _now + ((uint32_t)1 << (N_LEVELS * SLOT_BITS)) - 1;
+            }
+            slot = &_wheel[level][(expiry >> (level * SLOT_BITS)) & (N_SLOTS - 1)];
+        }
+
+        timer.next = *slot;
+        if (timer.next != nullptr) {
+            timer.next->pprev = &timer.next;
+        }
+        timer.pprev = slot;
+        *slot = &timer;
+    }
+
+    // Internal function which removes the timer from its list. Must be called in a critical section.
+    void unlink(Timer& timer) {
+        *timer.pprev = timer.next;
+        if (timer.next != nullptr) {
+            timer.next->pprev = timer.pprev;
+        }
+        timer.next = nullptr;
+        timer.pprev = nullptr;
+    }
+
+    // Internal function which moves the given list to a local head, so that the timers can be
+    // processed while other timers are inserted in the same slot. Must be called in a critical section.
+    void detach(Timer** slot, Timer*& head) {
+        head = *slot;
+        *slot = nullptr;
+        if (head != nullptr) {
+            head->pprev = &head;
+        }
+    }
+
+    // Call the handler after the given delay in ticks (at least 1), then every period ticks if period
+    // is not 0. If deferred is true, the handler is called from PendSV instead of the tick interrupt.
+    // If the timer is already running, it is restarted.
+    void start(Timer& timer, Callback<> handler, uint32_t delay, uint32_t period, bool deferred) {
+        if (delay == 0) {
+            delay = 1;
+        }
+
+        uint32_t primask = Core::enterCriticalSection();
+        if (timer.pprev != nullptr) {
+            unlink(timer);
+        }
+        timer.handler = handler;
+        timer.period = period;
+        timer.deferred = deferred;
+        timer.deferredPending = false;
+        timer.expiry = _now + delay - 1;
+        insert(timer);
+        Core::exitCriticalSection(primask);
+    }
+
+    // Stop the timer. A deferred call which is already posted will not call the handler.
+    void cancel(Timer& timer) {
+        uint32_t primask = Core::enterCriticalSection();
+        if (timer.pprev != nullptr) {
+            unlink(timer);
+        }
+        timer.deferredPending = false;
+        Core::exitCriticalSection(primask);
+    }
+
+    bool isRunning(const Timer& timer) {
+        return timer.pprev != nullptr;
+    }
+
+    // Process the next tick. This is called by the TC or AST interrupt, or can be called by the
+    // application from its own periodic interrupt.
+    void tick() {
+        uint32_t primask = Core::enterCriticalSection();
+        uint32_t now = _now;
+        uint32_t index = now & (N_SLOTS - 1);
+
+        // At the beginning of each turn of a level, cascade the current slot of the next level
+        Timer* head = nullptr;
+        for (int level = 1; level < N_LEVELS && (now & (((uint32_t)1 << (level * SLOT_BITS)) - 1)) == 0; level++) {
+            detach(&_wheel[level][(now >> (level * SLOT_BITS)) & (N_SLOTS - 1)], head);
+            while (head != nullptr) {
+                Timer& timer = *head;
+                unlink(timer);
+                insert(timer);
+            }
+        }
+
+        // Take the timers of the current slot, and move on to the next tick so that restarted
+        // timers are inserted relative to it
+        detach(&_wheel[0][index], head);
+        _now = now + 1;
+        Core::exitCriticalSection(primask);
+
+        while (1) {
+            primask = Core::enterCriticalSection();
+            if (head == nullptr) {
+                Core::exitCriticalSection(primask);
+                break;
+            }
+            Timer& timer = *head;
+            unlink(timer);
+
+            // Periodic timers are rescheduled relative to their expiry, so that they don't drift
+            if (timer.period > 0) {
+                timer.expiry += timer.period;
+                insert(timer);
+            }
+            Callback<> handler = timer.handler;
+            bool deferred = timer.deferred;
+            if (deferred) {
+                timer.deferredPending = true;
+            }
+            Core::exitCriticalSection(primask);
+
+            if (deferred) {
+                Core::defer(callDeferred, (uint32_t)&timer);
+            } else if (handler) {
+                handler();
+            }
+        }
+    }
+
+    // Internal function called from PendSV for deferred timers
+    void callDeferred(uint32_t arg) {
+        Timer& timer = *(Timer*)arg;
+        if (!timer.deferredPending) {
+            return;
+        }
+        timer.deferredPending = false;
+        if (timer.handler) {
+            timer.handler();
+        }
+    }
+
+}
@@ -0,0 +1,47 @@
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+#include <stdint.h>
+#include <tc.h>
+#include <callback.h>
+
+// This helper multiplexes any number of software timers onto a single periodic tick, provided
+// by a TC counter, by the AST periodic interrupt or by the application calling tick(). Timers
+// are sorted in a hierarchical wheel : N_LEVELS levels of N_SLOTS slots, each level covering
+// N_SLOTS times the range of the previous one. Starting and cancelling a timer is O(1), and each
+// tick only looks at a single slot, except every N_SLOTS ticks where the timers of one slot of
+// the next level are redistributed ("cascaded") to the lower level.
+// The Timer structures are allocated by the application, so there is no limit to the number of
+// timers. A structure must stay valid while its timer is running.
+// Handlers are called from the tick interrupt, or from PendSV if the timer is deferred (see
+// Core::defer()). Delays and periods are expressed in ticks ; delays longer than the range of
+// the wheel (2^24 ticks) are supported, the timer is then cascaded again from the last level.
+namespace TimerWheel {
+
+    const int SLOT_BITS = 6;
+    const int N_SLOTS = 1 << SLOT_BITS;
+    const int N_LEVELS = 4;
+
+    // The fields are managed by the module and must not be modified directly
+    struct Timer {
+        Timer* next = nullptr;
+        Timer** pprev = nullptr;
+        uint32_t expiry = 0;
+        uint32_t period = 0;
+        Callback<> handler;
+        bool deferred = false;
+        volatile bool deferredPending = false;
+    };
+
+    // Module API
+    void initTC(TC::Counter counter, unsigned long tickPeriod, TC::Unit unit=TC::Unit::MILLISECONDS);
+    void initAST(uint8_t interval);
+    void tick();
+    uint32_t now();
+    void start(Timer& timer, Callback<> handler, uint32_t delay, uint32_t period=0, bool deferred=false);
+    void cancel(Timer& timer);
+    bool isRunning(const Timer& timer);
+
+}
+
+#endif